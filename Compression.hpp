@@ -17,6 +17,18 @@ public:
     static std::vector<uint8_t> compress(const std::vector<uint8_t>& data, Algorithm algorithm = Algorithm::ZSTD);
     static std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressedData, Algorithm algorithm = Algorithm::ZSTD);
 
+    // Buffer variants for pooled packets: write into caller memory and never
+    // allocate. compress returns 0 when the output would not fit or would not
+    // save enough to be worth sending compressed; decompress returns 0 on failure.
+    static size_t compress(const uint8_t* data, size_t size, uint8_t* output, size_t capacity,
+                           Algorithm algorithm = Algorithm::ZSTD);
+    static size_t compressBound(size_t size, Algorithm algorithm = Algorithm::ZSTD);
+    static size_t decompress(const uint8_t* data, size_t size, uint8_t* output, size_t capacity,
+                             Algorithm algorithm = Algorithm::ZSTD);
+
+    // Original size recorded in a compressed payload, or 0 when it cannot be read
+    static size_t getDecompressedSize(const uint8_t* data, size_t size, Algorithm algorithm = Algorithm::ZSTD);
+
     // Helper to determine if compression would be beneficial
     static bool shouldCompress(const std::vector<uint8_t>& data, Algorithm algorithm = Algorithm::ZSTD);
 
@@ -24,6 +36,7 @@ private:
     // Compression thresholds (in bytes)
     static constexpr size_t MIN_COMPRESSION_SIZE = 64;
     static constexpr float COMPRESSION_RATIO_THRESHOLD = 0.8f; // Only compress if we can achieve at least 20% reduction
+    static constexpr size_t LZ4_SIZE_PREFIX = 4;    // LZ4 frames carry the original size up front
 };
 
 } // namespace BarrenEngine 
\ No newline at end of file
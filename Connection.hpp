@@ -1,11 +1,19 @@
 #pragma once
 
-#include <unordered_map>
-#include <queue>
+#include <array>
 #include <chrono>
+#include <memory>
+#include <queue>
+#include <functional>
 #include <mutex>
 #include <vector>
 #include <cstdint>
+#include "buffer/PacketBuffer.hpp"
+#include "protocol/WireHeader.hpp"
+#include "protocol/SequenceBuffer.hpp"
+#include "protocol/ReplayWindow.hpp"
+#include "protocol/FecCodec.hpp"
+#include "protocol/CongestionController.hpp"
 
 namespace BarrenEngine {
 
@@ -18,62 +26,227 @@ enum class PacketReliability {
 };
 
 struct Packet {
-    uint32_t sequenceNumber;
+    uint32_t sequenceNumber;      // Assigned when the packet first leaves the send queue
     uint32_t timestamp;
     PacketReliability reliability;
-    std::vector<uint8_t> data;
+    PacketBuffer data;
+    WireHeader header;            // Sequence fields are filled in and encoded when the packet is sent
     bool isAcknowledged;
+    uint32_t resendCount;
+    std::chrono::steady_clock::time_point sendTime;          // First transmission, for RTT samples
     std::chrono::steady_clock::time_point lastResendTime;
+    std::chrono::steady_clock::time_point resendDeadline;
+    uint32_t flightSize = 0;      // Bytes counted in flight for congestion control, 0 once acked or lost
+    uint64_t deliveredAtSend = 0;                              // Delivery progress when last sent, for rate samples
+    std::chrono::steady_clock::time_point deliveredTimeAtSend;
+    std::chrono::steady_clock::time_point firstSentTimeAtSend; // Send time of the newest delivered packet then
+    bool appLimited = false;      // Sent while the application left the window unfilled
 };
 
+// Received payload released by its channel, ready for reassembly and delivery
+struct InboundPacket {
+    WireHeader header;
+    PacketBuffer data;
+};
+
+// Reliability follows the sequence buffer scheme: every packet but an
+// UNRELIABLE one carries a 16-bit sequence, and every outgoing header
+// piggybacks the newest sequence received from the peer plus a bitfield for
+// the 32 before it. Sent packets live in a fixed window indexed by sequence
+// and received ones in a bitmap window, so an ack costs a few array lookups
+// and no ack packet of its own is sent while there is traffic to carry it.
+// The bitfield acks selectively, so a reliable packet still missing when a
+// packet FAST_RETRANSMIT_THRESHOLD sequences newer is acked is resent right
+// away rather than on its timeout.
+//
+// Sequenced and ordered packets additionally travel on one of MAX_CHANNELS
+// channels, each with its own order sequences and reorder buffer, so a loss
+// on one channel never holds back delivery on another.
+//
+// With FEC enabled, every group of UNRELIABLE_SEQUENCED packets is followed
+// by parity packets the peer rebuilds lost members from without a round
+// trip. A rebuilt packet is released even when newer ones on its channel
+// were delivered meanwhile.
+//
+// A reliable packet still unacked after MAX_RESEND_ATTEMPTS resends marks the
+// connection dead: its queues are dropped and isConnected() turns false.
+//
+// A congestion controller bounds the reliable bytes in flight and sets a
+// pacing rate; reliable packets spend pacing credit, so a large queue leaves
+// in evenly spaced bursts instead of all at once. Unreliable packets are not
+// paced, and once MAX_OUTGOING_PACKETS are queued the oldest are dropped.
 class Connection {
 public:
-    Connection(uint32_t maxPacketSize = 1024);
+    static constexpr uint8_t MAX_CHANNELS = 16;
+
+    Connection(uint32_t maxPacketSize = 1024, BufferPool* bufferPool = nullptr);
     ~Connection();
 
     // Packet handling
-    void queuePacket(const std::vector<uint8_t>& data, PacketReliability reliability);
-    bool processIncomingPacket(const std::vector<uint8_t>& data);
+    void queuePacket(const std::vector<uint8_t>& data, PacketReliability reliability, uint8_t channel = 0);
+    void queuePacket(PacketBuffer data, PacketReliability reliability, uint8_t channel = 0,
+                     const WireHeader& header = WireHeader());
+    // Applies the acks in a decoded header, drops duplicates and stale
+    // sequenced packets, and appends whatever the payload's channel can now
+    // deliver in order to released. A bare ack carries an empty payload.
+    void processIncomingPacket(const WireHeader& header, PacketBuffer data, std::vector<InboundPacket>& released,
+                               bool recovered = false);
+    // True for a sequence already received or too old to tell. Checked before
+    // decryption so a resend costs nothing but the ack it calls for, which
+    // processIncomingPacket still takes care of given an empty payload.
+    bool isDuplicate(const WireHeader& header);
+    // Feeds a received FEC packet, still encrypted, to the decoder. Each
+    // rebuilt packet is appended to recovered as its header and payload, to
+    // be decoded and passed to processIncomingPacket as recovered.
+    void recoverFecPackets(const WireHeader& header, const uint8_t* payload, size_t size,
+                           std::vector<PacketBuffer>& recovered);
+    // Follow every dataPackets UNRELIABLE_SEQUENCED packets with parityPackets
+    // parity packets (both 1 to 15, 0 data packets turns FEC off)
+    void enableFec(uint8_t dataPackets, uint8_t parityPackets);
+    // CUBIC unless changed; NONE sends whatever the sequence window allows
+    void setCongestionControl(CongestionAlgorithm algorithm);
+    // Appends the datagrams due now to packets, moved out of the connection;
+    // a resend shares the payload block kept for later attempts. Reusing
+    // the same vector across calls keeps the send path allocation-free.
+    void getPacketsToSend(std::vector<Packet>& packets);
+    // Sends a bare header with the next flush unless other packets go out;
+    // it takes no sequence or window slot and the peer delivers nothing
+    void queueKeepAlive();
     std::vector<Packet> getPacketsToSend();
     void update(float deltaTime);
+    std::chrono::steady_clock::time_point getNextSendTime();
 
     // Connection state
     bool isConnected() const { return connected_; }
     void setConnected(bool connected) { connected_ = connected; }
     float getRTT() const { return rtt_; }
+    float getRTO() const { return rto_; }
     float getPacketLoss() const { return packetLoss_; }
+    size_t getCongestionWindow() const { return congestion_ ? congestion_->getCongestionWindow() : 0; }
+    size_t getBytesInFlight() const { return bytesInFlight_; }
+    float getPacingRate() const { return congestion_ ? congestion_->getPacingRate() : 0.0f; }
 
     // Statistics
     uint32_t getPacketsSent() const { return packetsSent_; }
     uint32_t getPacketsReceived() const { return packetsReceived_; }
     uint32_t getPacketsLost() const { return packetsLost_; }
+    uint32_t getFastRetransmits() const { return fastRetransmits_; }
+    uint32_t getFecRecovered() const { return fecRecovered_; }
+    uint32_t getDuplicatesDropped() const { return duplicatesDropped_; }
+    uint32_t getPacketsDropped() const { return packetsDropped_; }   // Unreliable packets shed by a full send queue
 
 private:
-    void handleAcknowledgment(uint32_t sequenceNumber);
-    void resendUnacknowledgedPackets();
-    bool shouldResendPacket(const Packet& packet) const;
+    static constexpr size_t SENT_BUFFER_SIZE = 256;         // Most sequenced packets in flight
+    static constexpr size_t RECEIVED_BUFFER_SIZE = 1024;
+    static constexpr size_t MAX_OUTGOING_PACKETS = 1024;    // Queued packets before unreliable ones are shed
+    static constexpr size_t REORDER_BUFFER_SIZE = SENT_BUFFER_SIZE;   // The send window bounds how far ahead a peer runs
+    static constexpr uint32_t ACK_BITS = 32;
+    static constexpr size_t MAX_EXPLICIT_ACKS = 64;
+    static constexpr uint16_t FAST_RETRANSMIT_THRESHOLD = 3;
+
+    struct Channel {
+        uint16_t nextOrderedSequence = 0;
+        uint16_t nextSequencedSequence = 0;
+        uint16_t expectedOrderedSequence = 0;
+        uint16_t newestSequencedSequence = 0;
+        bool hasSequenced = false;
+        std::unique_ptr<SequenceBuffer<InboundPacket, REORDER_BUFFER_SIZE>> reorderBuffer;  // Allocated on the first gap
+    };
+
+    // Entries are left behind when a packet is acked or rescheduled and are
+    // skipped when they reach the top
+    struct ResendTimer {
+        std::chrono::steady_clock::time_point deadline;
+        uint16_t sequence;
+
+        bool operator>(const ResendTimer& other) const { return deadline > other.deadline; }
+    };
+
+    void handleAcknowledgment(uint16_t sequence, std::chrono::steady_clock::time_point now);
+    void detectLosses(std::chrono::steady_clock::time_point now);
+    void updateRoundTripTime(float sample);
+    std::chrono::steady_clock::duration getResendTimeout(const Packet& packet) const;
+    bool acceptSequence(uint16_t sequence);
+    void releaseInOrder(const WireHeader& header, PacketBuffer data, std::vector<InboundPacket>& released,
+                        bool recovered);
+    uint32_t getAckBits(uint16_t ack) const;
+    Packet makeAckPacket(uint16_t ack) const;
+    void appendParityPackets(std::vector<Packet>& packets);
+    bool writeHeader(Packet& packet) const;
+    void coalescePackets(std::vector<Packet>& packets, std::vector<Packet>& datagrams) const;
+    Packet makeBundle(std::vector<Packet>& packets, size_t begin, size_t end, size_t size) const;
+    void advanceOldestUnacknowledged();
+    void failConnection();
+    void scheduleResend(Packet& packet, std::chrono::steady_clock::time_point now);
+    void addToFlight(Packet& packet, std::chrono::steady_clock::time_point now);
+    void removeFromFlight(Packet& packet);
+    bool isCongestionLimited(const Packet& packet) const;
+    void refillPacingCredit(std::chrono::steady_clock::time_point now);
+    bool isResendTimerCurrent(const ResendTimer& timer);
     void updateStatistics();
 
-    std::unordered_map<uint32_t, Packet> unacknowledgedPackets_;
-    std::queue<Packet> outgoingPackets_;
+    SequenceBuffer<Packet, SENT_BUFFER_SIZE> sentPackets_;   // Reliable entries keep their payload for resends
+    ReplayWindow<RECEIVED_BUFFER_SIZE> receivedWindow_;     // Newest sequence received from the peer and the ones before it
+    std::priority_queue<ResendTimer, std::vector<ResendTimer>, std::greater<ResendTimer>> resendTimers_;
+    std::vector<Packet> outgoingPackets_;     // Sequenced packets wait here while the send window is full
+    std::vector<Packet> flushPackets_;        // Scratch for getPacketsToSend, kept for its capacity
+    std::array<Channel, MAX_CHANNELS> channels_;
+    std::unique_ptr<FecEncoder> fecEncoder_;
+    std::unique_ptr<FecDecoder> fecDecoder_;  // Allocated on the first FEC packet received
+    std::unique_ptr<CongestionController> congestion_;
     std::mutex packetMutex_;
+    BufferPool* bufferPool_;
 
-    uint32_t nextSequenceNumber_;
-    uint32_t maxPacketSize_;
+    uint16_t nextSequence_;
+    uint16_t oldestUnacknowledged_;           // Start of the send window
+    uint16_t largestAcknowledged_;
+    bool hasLargestAcknowledged_;
+    uint16_t lossScanSequence_;               // Sequences before this were already checked for fast retransmit
+    bool ackPending_;                         // Received packets not yet acked in any outgoing header
+    std::chrono::steady_clock::time_point ackDeadline_;
+    uint32_t receivedSinceAck_;
+    bool keepAlivePending_;                   // Send a bare header on the next flush if nothing else goes out
+    std::vector<uint16_t> explicitAcks_;      // Acks the bitfield of the next header would not cover
+    uint32_t maxPacketSize_;                  // Largest datagram, bundles are packed up to it
     bool connected_;
-    float rtt_;
+    float rtt_;                               // Smoothed RTT in seconds
+    float rttVariance_;
+    float rto_;
+    bool hasRttSample_;
     float packetLoss_;
 
+    // Congestion control
+    size_t bytesInFlight_;                    // Reliable bytes sent and neither acked nor declared lost
+    uint64_t delivered_;                      // Reliable bytes acked over the connection's life
+    std::chrono::steady_clock::time_point deliveredTime_;
+    std::chrono::steady_clock::time_point firstSentTime_;     // Send time of the newest delivered packet
+    uint64_t appLimitedUntil_;                // Samples are app-limited until delivered_ passes this, 0 when not
+    float pacingCredit_;                      // Bytes that may leave before the pacer holds packets back
+    std::chrono::steady_clock::time_point pacingUpdate_;
+    std::chrono::steady_clock::time_point pacingResume_;
+    bool pacingBlocked_;                      // Packets are waiting for pacingResume_
+
     // Statistics
     uint32_t packetsSent_;
     uint32_t packetsReceived_;
     uint32_t packetsLost_;
+    uint32_t fastRetransmits_;
+    uint32_t fecRecovered_;
+    uint32_t duplicatesDropped_;
+    uint32_t packetsDropped_;
     std::chrono::steady_clock::time_point lastStatsUpdate_;
 
     // Constants
-    static constexpr float RESEND_TIMEOUT = 0.1f;  // 100ms
+    static constexpr float INITIAL_RTO = 0.1f;  // 100ms, until the first RTT sample
+    static constexpr float MIN_RTO = 0.02f;     // Covers the peer's ACK_DELAY
+    static constexpr float MAX_RTO = 2.0f;
+    static constexpr float RTT_ALPHA = 0.125f;  // RFC 6298 gains
+    static constexpr float RTT_BETA = 0.25f;
+    static constexpr float ACK_DELAY = 0.01f;  // Wait this long for outgoing traffic before sending a bare ack
+    static constexpr float PACING_QUANTUM = 0.001f;   // Burst allowed at high rates, in seconds of pacing
+    static constexpr uint32_t PACING_BURST_PACKETS = 2;  // Burst allowed at low rates
     static constexpr float STATS_UPDATE_INTERVAL = 1.0f;  // 1 second
-    static constexpr uint32_t MAX_RESEND_ATTEMPTS = 5;
+    static constexpr uint32_t MAX_RESEND_ATTEMPTS = 10;  // About 15 s of backoff before giving up
 };
 
 } // namespace BarrenEngine 
\ No newline at end of file
@@ -32,6 +32,7 @@ public:
     // Key generation
     static std::vector<uint8_t> generateKey(size_t keySize);
     static std::vector<uint8_t> generateIV();
+    static void generateIV(uint8_t* iv);
 
     // Core encryption/decryption
     static std::vector<uint8_t> encrypt(const std::vector<uint8_t>& data,
@@ -44,6 +45,19 @@ public:
                                       const std::vector<uint8_t>& iv,
                                       Mode mode = Mode::GCM);
 
+    // In-place encryption for pooled buffers: data holds size plaintext bytes
+    // inside capacity bytes of storage, which must cover getOverhead(mode) more.
+    // Return the resulting ciphertext or plaintext length.
+    static size_t encrypt(uint8_t* data, size_t size, size_t capacity,
+                          const std::vector<uint8_t>& key,
+                          const uint8_t* iv,
+                          Mode mode = Mode::GCM);
+    static size_t decrypt(uint8_t* data, size_t size,
+                          const std::vector<uint8_t>& key,
+                          const uint8_t* iv,
+                          Mode mode = Mode::GCM);
+    static size_t getOverhead(Mode mode) { return BLOCK_SIZE + (mode == Mode::GCM ? GCM_TAG_SIZE : 0); }
+
     // Helper functions
     static bool validateKey(const std::vector<uint8_t>& key);
     static bool validateIV(const std::vector<uint8_t>& iv);
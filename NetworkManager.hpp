@@ -9,13 +9,22 @@
 #include <functional>
 #include <atomic>
 #include <map>
+#include <unordered_map>
 #include <chrono>
 #include "Connection.hpp"
 #include "Compression.hpp"
 #include "Crypto.hpp"
+#include "buffer/PacketBuffer.hpp"
+#include "buffer/MessageRing.hpp"
+#include "transport/UdpSocket.hpp"
+#include "transport/Reactor.hpp"
+#include "transport/UringTransport.hpp"
+#include "protocol/FragmentAssembler.hpp"
 #include <fstream>
 
-#ifdef BARREN_ENGINE_EXPORTS
+#if !defined(_WIN32)
+    #define BARREN_API __attribute__((visibility("default")))
+#elif defined(BARREN_ENGINE_EXPORTS)
     #define BARREN_API __declspec(dllexport)
 #else
     #define BARREN_API __declspec(dllimport)
@@ -28,6 +37,17 @@ enum class NetworkProtocol {
     TCP
 };
 
+enum class TransportBackend {
+    SOCKET,     // recvmmsg/sendmmsg on a plain socket
+    IO_URING    // io_uring with registered buffers, falls back to SOCKET when unsupported
+};
+
+enum class InboundOverflowPolicy {
+    DROP_NEWEST,    // Discard arriving messages while the inbound queue is full
+    DROP_OLDEST,    // Evict the oldest queued message to make room
+    BLOCK           // Stall the network thread until the application drains the queue
+};
+
 struct BARREN_API NetworkConfig {
     NetworkProtocol protocol;
     uint16_t port;
@@ -41,10 +61,20 @@ struct BARREN_API NetworkConfig {
     uint32_t maxPacketSize;        // Maximum size of a single packet
     uint32_t fragmentSize;         // Size of packet fragments
     uint32_t fragmentTimeout;      // Timeout for fragment reassembly in milliseconds
+    uint32_t maxMessageSize;       // Largest message accepted for reassembly (0 = 16 MB)
+    uint32_t maxReassemblyBytes;   // Bytes a shard reserves for partly received messages (0 = 64 MB)
     uint32_t connectionTimeout;    // Connection timeout in milliseconds
     uint32_t keepAliveInterval;    // Keep-alive interval in milliseconds
     bool enablePacketValidation;   // Enable packet validation
     bool enablePacketLogging;      // Enable packet logging
+    TransportBackend transport;    // Datagram I/O backend
+    uint32_t workerThreads;        // Server shards, one SO_REUSEPORT socket each (0 = 1)
+    bool enableSegmentationOffload; // UDP GSO for fragment bursts, GRO on receive (socket backend)
+    uint32_t inboundQueueSize;     // Received messages buffered for receive() (0 = default, rounded to a power of two)
+    InboundOverflowPolicy inboundOverflowPolicy; // What happens when the application falls behind
+    uint8_t fecDataPackets;        // UNRELIABLE_SEQUENCED packets per FEC group (0 = no FEC, at most 15)
+    uint8_t fecParityPackets;      // Parity packets sent after each group (1 to 15)
+    CongestionAlgorithm congestionControl; // Send window and pacing of each connection
 };
 
 struct BARREN_API NetworkMessage {
@@ -55,6 +85,27 @@ struct BARREN_API NetworkMessage {
     uint32_t fragmentIndex;       // Fragment index for fragmented messages
     uint32_t totalFragments;      // Total number of fragments
     bool isFragment;              // Whether this is a fragment
+    uint32_t clientId;            // Remote client (destination on send, source on receive)
+    uint8_t channel;              // Ordering channel for the sequenced and ordered modes (< Connection::MAX_CHANNELS)
+};
+
+// Received message that borrows its payload from a pooled packet buffer
+// instead of copying it into a vector. The payload is read-only and the
+// buffer returns to its pool when the view is released or destroyed.
+struct BARREN_API NetworkMessageView {
+    PacketBuffer buffer;
+    uint32_t timestamp;
+    PacketReliability reliability;
+    uint32_t messageId;
+    uint32_t fragmentIndex;
+    uint32_t totalFragments;
+    bool isFragment;
+    uint32_t clientId;            // Source client
+    uint8_t channel;
+
+    const uint8_t* data() const { return buffer.data(); }
+    size_t size() const { return buffer.size(); }
+    void release() { buffer.reset(); }
 };
 
 class BARREN_API NetworkManager {
@@ -73,6 +124,16 @@ public:
     bool receive(NetworkMessage& message);
     void setMessageCallback(std::function<void(const NetworkMessage&)> callback);
 
+    // Zero-copy receive; the view keeps its pooled buffer until released
+    bool receive(NetworkMessageView& message);
+
+    // Drain up to count queued messages in one call; returns how many were filled
+    size_t receiveBatch(NetworkMessage* messages, size_t count);
+    size_t receiveBatch(NetworkMessageView* messages, size_t count);
+    void setMessageViewCallback(std::function<void(const NetworkMessageView&)> callback);
+    // Called from a shard thread once a peer stops acking or exceeds connectionTimeout
+    void setDisconnectCallback(std::function<void(uint32_t)> callback);
+
     // Connection management
     void disconnectClient(uint32_t clientId);
     bool isClientConnected(uint32_t clientId) const;
@@ -83,6 +144,8 @@ public:
     float getPacketLoss() const;
     size_t getBytesSent() const;
     size_t getBytesReceived() const;
+    size_t getDroppedMessages() const;
+    size_t getDroppedDatagrams() const;     // Outgoing datagrams too large for an io_uring send slot
 
     // Advanced features
     void setPacketValidation(bool enable);
@@ -94,52 +157,91 @@ public:
     void setFragmentTimeout(uint32_t milliseconds);
 
 private:
-    struct FragmentInfo {
-        std::vector<NetworkMessage> fragments;
-        std::chrono::steady_clock::time_point timestamp;
-        uint32_t totalFragments;
-        uint32_t receivedFragments;
+    static constexpr uint32_t INVALID_CLIENT_ID = UINT32_MAX;
+    static constexpr uint32_t SHARD_SHIFT = 24;   // Client ids carry their owning shard in the top byte
+    static constexpr uint32_t MAX_SHARDS = 1u << (32 - SHARD_SHIFT);
+    static constexpr uint32_t DEFAULT_INBOUND_QUEUE_SIZE = 4096;
+
+    // One worker thread with its own socket and connection table. The kernel
+    // hashes each 4-tuple to one SO_REUSEPORT socket, so a connection is only
+    // ever touched by the shard that owns it.
+    struct Shard {
+        uint32_t index;
+        UdpSocket socket;
+        Reactor reactor;
+        UringTransport uring;
+        std::thread thread;
+
+        std::map<uint32_t, std::unique_ptr<Connection>> connections;
+        mutable std::mutex connectionsMutex;      // Only contended by control-plane calls
+        std::unordered_map<Endpoint, uint32_t, EndpointHash> clientIds;
+        std::map<uint32_t, Endpoint> clientEndpoints;
+        uint32_t nextLocalId;
+
+        // Owned by the shard thread
+        FragmentAssembler fragments;
+        std::map<uint32_t, std::chrono::steady_clock::time_point> lastActivity;
+        std::chrono::steady_clock::time_point lastKeepAlive;
+        std::chrono::steady_clock::time_point nextTimeoutCheck;
+        std::vector<InboundPacket> releasedPackets;   // Reused for each received packet
+
+        // Statistics
+        std::atomic<size_t> bytesSent;
+        std::atomic<size_t> bytesReceived;
+        std::atomic<float> averageLatency;
+        std::atomic<float> packetLoss;
+
+        Shard(uint32_t shardIndex, BufferPool& pool, const NetworkConfig& config)
+            : index(shardIndex), nextLocalId(1)
+            , fragments(pool, config.fragmentSize, config.maxMessageSize, config.fragmentTimeout,
+                        config.maxReassemblyBytes)
+            , bytesSent(0), bytesReceived(0), averageLatency(0.0f), packetLoss(0.0f) {}
     };
 
-    bool setupSocket();
+    bool setupSockets(uint32_t shardCount, uint16_t port);
+    bool setupSocket(Shard& shard, bool reusePort, uint16_t port);
     void cleanupSocket();
-    void networkLoop();
-    void processIncomingData(const std::vector<uint8_t>& data, uint32_t clientId);
-    std::vector<uint8_t> processOutgoingData(const std::vector<uint8_t>& data);
-    void updateStatistics();
-    void handleKeepAlive();
-    void checkConnectionTimeouts();
-    void validatePacket(const std::vector<uint8_t>& data);
-    void logPacket(const std::vector<uint8_t>& data, bool isOutgoing);
-    std::vector<NetworkMessage> fragmentMessage(const NetworkMessage& message);
-    NetworkMessage reassembleFragments(FragmentInfo& fragmentInfo);
-    bool isFragmentComplete(const FragmentInfo& fragmentInfo) const;
-    void cleanupExpiredFragments();
+    void startWorkers();
+    void stopWorkers();
+    Shard* findShard(uint32_t clientId) const;
+    void networkLoop(Shard& shard);
+    void receivePackets(Shard& shard, std::vector<Datagram>& slots, std::vector<PacketBuffer>& slotBuffers);
+    void flushOutgoingPackets(Shard& shard, std::vector<Packet>& packets, std::vector<Datagram>& datagrams);
+    std::chrono::steady_clock::time_point getNextDeadline(Shard& shard);
+    uint32_t findOrAcceptClient(Shard& shard, const Endpoint& endpoint);
+    int receiveDatagrams(Shard& shard, Datagram* datagrams, size_t count);
+    int sendDatagrams(Shard& shard, const Datagram* datagrams, size_t count);
+    uint32_t getDatagramLimit() const;
+    void processIncomingData(Shard& shard, PacketBuffer packet, uint32_t clientId);
+    void processBundle(Shard& shard, const WireHeader& header, PacketBuffer bundle, uint32_t clientId);
+    void processPacket(Shard& shard, const WireHeader& header, PacketBuffer packet, uint32_t clientId,
+                       bool recovered = false);
+    void recoverPackets(Shard& shard, const WireHeader& header, const PacketBuffer& packet, uint32_t clientId);
+    void acceptPacket(Shard& shard, uint32_t clientId, const WireHeader& header, PacketBuffer packet,
+                      bool recovered = false);
+    void deliverPacket(Shard& shard, const WireHeader& header, PacketBuffer packet, uint32_t clientId);
+    void enqueueMessage(NetworkMessageView&& message);
+    bool processOutgoingData(PacketBuffer& buffer, WireHeader& header);
+    void updateStatistics(Shard& shard);
+    void handleKeepAlive(Shard& shard);
+    void checkConnectionTimeouts(Shard& shard);
+    void closeConnection(Shard& shard, uint32_t clientId);
+    void validatePacket(const uint8_t* data, size_t size);
+    void logPacket(const uint8_t* data, size_t size, bool isOutgoing);
 
     NetworkConfig config_;
     std::atomic<bool> running_;
-    int socket_;
-    std::thread networkThread_;
+    bool isServer_;
+    std::unique_ptr<BufferPool> bufferPool_;    // Declared before shards_ so it outlives their packets
+    std::vector<std::unique_ptr<Shard>> shards_;
     std::function<void(const NetworkMessage&)> messageCallback_;
-    std::queue<NetworkMessage> messageQueue_;
-    std::mutex messageQueueMutex_;
-    std::map<uint32_t, std::unique_ptr<Connection>> connections_;
-    mutable std::mutex connectionsMutex_;
-
-    // Statistics
-    std::atomic<size_t> bytesSent_;
-    std::atomic<size_t> bytesReceived_;
-    std::atomic<float> averageLatency_;
-    std::atomic<float> packetLoss_;
+    std::function<void(const NetworkMessageView&)> messageViewCallback_;
+    std::function<void(uint32_t)> disconnectCallback_;
+    std::unique_ptr<MessageRing<NetworkMessageView>> messageQueue_;   // Shard threads push, the application pops
+    std::atomic<size_t> droppedMessages_;
 
     // Fragment management
-    std::map<uint32_t, FragmentInfo> fragmentMap_;
-    std::mutex fragmentMutex_;
-    uint32_t nextMessageId_;
-
-    // Keep-alive
-    std::chrono::steady_clock::time_point lastKeepAlive_;
-    std::map<uint32_t, std::chrono::steady_clock::time_point> lastActivity_;
+    std::atomic<uint32_t> nextMessageId_;
 
     // Packet validation
     bool packetValidationEnabled_;
@@ -148,6 +250,7 @@ private:
     // Packet logging
     bool packetLoggingEnabled_;
     std::ofstream packetLog_;
+    std::mutex packetLogMutex_;
 };
 
 } // namespace BarrenEngine 
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
-#include <queue>
+#include <cstdint>
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include <mutex>
 #include <atomic>
+#include "buffer/MessageRing.hpp"
 
 namespace BarrenEngine {
 
@@ -33,45 +37,243 @@ struct PacketMetadata {
     uint32_t sequenceNumber;
     bool requiresAck;
     float bandwidthLimit;  // Maximum bandwidth usage in bytes per second
+    uint32_t clientId;     // Flow the packet belongs to; flows of one priority share the link fairly
 };
 
 class PrioritizedPacket {
 public:
+    PrioritizedPacket() = default;
     PrioritizedPacket(const std::vector<uint8_t>& data, const PacketMetadata& metadata)
         : data_(data), metadata_(metadata) {}
+    PrioritizedPacket(std::vector<uint8_t>&& data, const PacketMetadata& metadata)
+        : data_(std::move(data)), metadata_(metadata) {}
 
     const std::vector<uint8_t>& getData() const { return data_; }
+    std::vector<uint8_t>& getData() { return data_; }
     const PacketMetadata& getMetadata() const { return metadata_; }
-    
-    bool operator<(const PrioritizedPacket& other) const {
-        if (metadata_.priority != other.metadata_.priority)
-            return static_cast<int>(metadata_.priority) > static_cast<int>(other.metadata_.priority);
-        return metadata_.deadline > other.metadata_.deadline;
-    }
 
 private:
     std::vector<uint8_t> data_;
     PacketMetadata metadata_;
 };
 
+// FIFO of packets in a power-of-two ring that doubles when full; once grown,
+// a push or a pop only moves a payload buffer in or out.
+class PacketRing {
+public:
+    PacketRing() : head_(0), count_(0) {}
+
+    bool empty() const { return count_ == 0; }
+    size_t size() const { return count_; }
+
+    void push(PrioritizedPacket&& packet);
+    PrioritizedPacket& front() { return slots_[head_]; }
+    void pop();
+
+    // Drops every packet pred holds for, keeping the rest in order, and
+    // returns how many went
+    template <typename Predicate>
+    size_t removeIf(Predicate pred) {
+        size_t kept = 0;
+        for (size_t i = 0; i < count_; ++i) {
+            PrioritizedPacket& packet = slots_[(head_ + i) & (slots_.size() - 1)];
+            if (pred(packet)) {
+                packet = PrioritizedPacket();
+            } else {
+                if (kept != i) {
+                    slots_[(head_ + kept) & (slots_.size() - 1)] = std::move(packet);
+                }
+                kept++;
+            }
+        }
+        size_t removed = count_ - kept;
+        count_ = kept;
+        return removed;
+    }
+
+private:
+    std::vector<PrioritizedPacket> slots_;
+    size_t head_;
+    size_t count_;
+};
+
+// Refills at rate bytes per second up to burst bytes. Taking more than it
+// holds leaves a debt that the refill pays off before anything else passes.
+class TokenBucket {
+public:
+    TokenBucket() : rate_(0.0), burst_(0.0), tokens_(0.0) {}
+
+    // A rate of 0 lets everything through
+    void configure(double rate, double burst, std::chrono::steady_clock::time_point now);
+    void refill(std::chrono::steady_clock::time_point now);
+    void take(size_t bytes) { if (rate_ > 0.0) tokens_ -= static_cast<double>(bytes); }
+    // Zero when bytes may pass now; a packet larger than the burst waits for a full bucket
+    std::chrono::steady_clock::duration getWaitTime(size_t bytes) const;
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point lastRefill_;
+};
+
+// Any number of threads may enqueue at once without taking a lock: packets
+// go into a lock-free ring per PacketPriority level, and a single consumer
+// thread moves them into the structures below whenever it dequeues. Only
+// that consumer and the setters take queueMutex_, and a producer only when
+// the consumer fell MAX_INGRESS packets behind on one level.
+//
+// Strict priority scheduler with a bitmask of the PacketPriority levels
+// holding packets. Within a level, deficit round robin shares the link
+// between clients: each client's packets wait in a FIFO ring of their own,
+// and every round a client may send up to its quantum (scaled by its weight)
+// in bytes, carrying what it did not use over to the next round. Enqueue is
+// O(1) and dequeue amortized O(1) whatever the number of clients, as long as
+// the quantum is at least a packet. A client's packets leave in order.
+//
+// ULTRA_LOW_LATENCY packets skip the round: each level keeps them in a heap
+// and sends them earliest deadline first, ahead of its other packets.
+//
+// No packet leaves past its deadline. Expired packets are dropped as they
+// come up, and every SWEEP_INTERVAL a sweep also reclaims those buried
+// further back, so a backlog of stale packets cannot hold the queue full.
+//
+// Dequeued bytes are shaped by a token bucket for the whole scheduler and,
+// where configured, one per QoSLevel. A packet waits for both, except that
+// CRITICAL packets always pass and leave their cost as debt for the rest.
+// While a class is out of tokens, the level's packets of other classes go.
 class PacketScheduler {
 public:
+    enum class DequeueResult {
+        PACKET,     // A packet was dequeued
+        EMPTY,      // Nothing is queued
+        THROTTLED   // Packets are queued but out of tokens; retry after the returned wait
+    };
+
     PacketScheduler(size_t maxQueueSize = 1000)
         : maxQueueSize_(maxQueueSize)
+        , queueSize_(0)
+        , nonEmptyLevels_(0)
+        , quantum_(DEFAULT_QUANTUM)
+        , deadlineOrder_(0)
+        , expiredPackets_()
+        , nextSweep_(std::chrono::steady_clock::now() + SWEEP_INTERVAL)
+        , burstSize_(0)
+        , meterBytes_(0)
+        , meterStart_(std::chrono::steady_clock::now())
         , currentBandwidth_(0)
-        , maxBandwidth_(0) {}
+        , maxBandwidth_(0)
+    {
+        for (auto& ring : ingress_) {
+            ring = std::make_unique<MessageRing<PrioritizedPacket>>(std::min(maxQueueSize, MAX_INGRESS));
+        }
+    }
 
+    // Return false when the scheduler already holds maxQueueSize packets.
+    // The rvalue overload takes over the caller's buffer instead of copying it.
     bool enqueuePacket(const std::vector<uint8_t>& data, const PacketMetadata& metadata);
+    bool enqueuePacket(std::vector<uint8_t>&& data, const PacketMetadata& metadata);
+    // Moves the next packet's payload into data, skipping expired packets.
+    // When throttled, wait is how long until the first blocked packet may go.
+    DequeueResult dequeuePacket(std::vector<uint8_t>& data, PacketMetadata& metadata,
+                                std::chrono::steady_clock::duration& wait);
     bool dequeuePacket(std::vector<uint8_t>& data, PacketMetadata& metadata);
+    // Appends up to maxPackets packets to packets under one lock, stopping
+    // early once nothing is queued or the buckets are out of tokens
+    size_t dequeueBatch(std::vector<PrioritizedPacket>& packets, size_t maxPackets);
+
+    // Bytes per second for everything dequeued (0 = unlimited), and the most
+    // that may leave at once after an idle spell (0 = BURST_TIME of the rate)
     void setMaxBandwidth(size_t bandwidth);
+    void setBurstSize(size_t bytes);
+    // Caps one QoS class below the overall limit (0 = no cap of its own)
+    void setQoSBandwidth(QoSLevel qos, size_t bandwidth, size_t burstSize = 0);
+    // Bytes a client may send per round at weight 1, and a client's share
+    // relative to the others (default 1)
+    void setQuantum(size_t bytes);
+    void setClientWeight(uint32_t clientId, uint32_t weight);
+    // Discards a client's queued packets and forgets it, e.g. once it disconnected
+    void removeClient(uint32_t clientId);
+
+    // Bytes per second dequeued or reported over the last measuring second
     size_t getCurrentBandwidth() const;
     size_t getQueueSize();
+    // Packets dropped for missing their deadline, in total or of one QoS class
+    size_t getExpiredPackets();
+    size_t getExpiredPackets(QoSLevel qos);
+    // Charges bytes sent around the scheduler, such as acks, to the overall bucket
     void updateBandwidthUsage(size_t bytes);
 
 private:
-    std::priority_queue<PrioritizedPacket> packetQueue_;
+    static constexpr size_t PRIORITY_LEVELS = 5;
+    static constexpr size_t QOS_LEVELS = 5;
+    static constexpr double BURST_TIME = 0.05;     // Default burst, in seconds of the rate
+    static constexpr double MIN_BURST = 1500.0;    // Any burst admits at least one full datagram
+    static constexpr size_t DEFAULT_QUANTUM = 1500;
+    static constexpr std::chrono::milliseconds SWEEP_INTERVAL{100};
+    static constexpr size_t MAX_INGRESS = 8192;    // Packets per level awaiting the consumer
+
+    struct Flow {
+        PacketRing packets;
+        uint32_t clientId = 0;
+        size_t quantum = 0;
+        size_t deficit = 0;         // Bytes the flow may still send this round
+        bool quantumAdded = false;  // This round's quantum was credited
+        Flow* next = nullptr;
+    };
+
+    struct DeadlinePacket {
+        PrioritizedPacket packet;
+        uint64_t order;             // Keeps equal deadlines first come, first served
+    };
+
+    // Flows with packets form a singly linked round; the head sends next.
+    // Only flows with packets are kept.
+    struct Level {
+        std::unordered_map<uint32_t, std::unique_ptr<Flow>> flows;
+        Flow* head = nullptr;
+        Flow* tail = nullptr;
+        std::vector<DeadlinePacket> deadlines;  // Min-heap on deadline
+    };
+
+    void drainIngress();
+    void admit(PrioritizedPacket&& packet);
+    DequeueResult takeNext(std::chrono::steady_clock::time_point now, std::vector<uint8_t>& data,
+                           PacketMetadata& metadata, std::chrono::steady_clock::duration& wait);
+    std::chrono::steady_clock::duration getWaitTime(const PrioritizedPacket& packet, bool& linkLimited) const;
+    void takePacket(PrioritizedPacket& packet, std::chrono::steady_clock::time_point now,
+                    std::vector<uint8_t>& data, PacketMetadata& metadata);
+    Flow* selectFlow(Level& level, std::chrono::steady_clock::time_point now);
+    void yieldTurn(Level& level, Flow& flow);
+    void popPacket(Level& level, Flow& flow);
+    void leaveRound(Level& level, Flow* previous, Flow& flow);
+    void popDeadline(Level& level);
+    void expireDeadlines(Level& level, std::chrono::steady_clock::time_point now);
+    void sweepExpired(std::chrono::steady_clock::time_point now);
+    void countExpired(const PrioritizedPacket& packet);
+    static bool laterDeadline(const DeadlinePacket& a, const DeadlinePacket& b);
+    size_t getQuantum(uint32_t clientId) const;
+    void charge(size_t bytes, std::chrono::steady_clock::time_point now);
+    static double getBurst(size_t bandwidth, size_t burstSize);
+
+    std::array<std::unique_ptr<MessageRing<PrioritizedPacket>>, PRIORITY_LEVELS> ingress_;
+    std::array<Level, PRIORITY_LEVELS> levels_;
     std::mutex queueMutex_;
     size_t maxQueueSize_;
+    std::atomic<size_t> queueSize_;     // Packets in the ingress rings and the levels
+    uint32_t nonEmptyLevels_;       // Bit n set: levels_[n] holds packets
+    size_t quantum_;
+    std::unordered_map<uint32_t, uint32_t> clientWeights_;  // Only clients not at weight 1
+    uint64_t deadlineOrder_;
+    std::array<size_t, QOS_LEVELS> expiredPackets_;
+    std::chrono::steady_clock::time_point nextSweep_;
+
+    // Shaping
+    TokenBucket bucket_;
+    std::array<TokenBucket, QOS_LEVELS> qosBuckets_;
+    size_t burstSize_;
+    size_t meterBytes_;
+    std::chrono::steady_clock::time_point meterStart_;
     std::atomic<size_t> currentBandwidth_;
     std::atomic<size_t> maxBandwidth_;
 };
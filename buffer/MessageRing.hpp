@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+
+namespace BarrenEngine {
+
+// Bounded lock-free ring (Vyukov's sequence-per-cell design). Any number of
+// producers and consumers may push and pop concurrently; each cell carries a
+// sequence number telling a thread whether the slot is free or filled for the
+// lap it is on, so neither side ever takes a lock. Capacity is rounded up to
+// a power of two and fixed at construction, so push and pop never allocate.
+template <typename T>
+class MessageRing {
+public:
+    explicit MessageRing(size_t capacity)
+        : mask_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity) - 1)
+        , cells_(new Cell[mask_ + 1])
+        , enqueuePosition_(0)
+        , dequeuePosition_(0)
+    {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MessageRing(const MessageRing&) = delete;
+    MessageRing& operator=(const MessageRing&) = delete;
+
+    // Moves from value only on success; returns false when the ring is full
+    bool tryPush(T&& value) {
+        size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false when the ring is empty
+    bool tryPop(T& value) {
+        size_t position = dequeuePosition_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[position & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (dequeuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to count values; stops at the first empty slot
+    size_t popBatch(T* values, size_t count) {
+        size_t popped = 0;
+        while (popped < count && tryPop(values[popped])) {
+            ++popped;
+        }
+        return popped;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Racy snapshot, only meaningful as a hint
+    size_t sizeApprox() const {
+        size_t enqueued = enqueuePosition_.load(std::memory_order_relaxed);
+        size_t dequeued = dequeuePosition_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    // Producers and consumers each get their own cache line
+    alignas(64) std::atomic<size_t> enqueuePosition_;
+    alignas(64) std::atomic<size_t> dequeuePosition_;
+};
+
+} // namespace BarrenEngine
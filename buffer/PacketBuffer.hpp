@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+namespace BarrenEngine {
+
+class BufferPool;
+
+// Ref-counted handle to a pooled packet block. The payload is a window
+// inside the block with headroom in front and tailroom behind it, so
+// headers, IVs and tags are added in place instead of by copying. Copies
+// share the block, which returns to its pool when the last handle goes.
+class PacketBuffer {
+public:
+    PacketBuffer() : block_(nullptr), head_(0), size_(0) {}
+    PacketBuffer(const PacketBuffer& other);
+    PacketBuffer(PacketBuffer&& other) noexcept;
+    PacketBuffer& operator=(const PacketBuffer& other);
+    PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+    ~PacketBuffer() { release(); }
+
+    uint8_t* data() { return block_ ? block_->payload() + head_ : nullptr; }
+    const uint8_t* data() const { return block_ ? block_->payload() + head_ : nullptr; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    explicit operator bool() const { return block_ != nullptr; }
+
+    size_t headroom() const { return head_; }
+    size_t tailroom() const { return block_ ? block_->capacity - head_ - size_ : 0; }
+
+    // Grow the payload into headroom or tailroom; nullptr when there is not enough room
+    uint8_t* prepend(size_t length);
+    uint8_t* append(size_t length);
+    bool append(const uint8_t* source, size_t length);
+
+    // Shrink the payload from the front, or set its length (up to size() + tailroom())
+    void consume(size_t length);
+    bool resize(size_t length);
+
+    // Writers must hold the only reference; shared blocks are read-only by convention
+    uint32_t useCount() const { return block_ ? block_->refCount.load(std::memory_order_acquire) : 0; }
+    void reset() { release(); }
+
+private:
+    friend class BufferPool;
+
+    struct Block {
+        std::atomic<uint32_t> refCount;
+        uint32_t capacity;
+        BufferPool* pool;       // nullptr for one-off oversized blocks
+        Block* next;            // Free list link while pooled
+
+        uint8_t* payload();
+    };
+
+    static constexpr size_t HEADER_SIZE =
+        (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    PacketBuffer(Block* block, uint32_t head) : block_(block), head_(head), size_(0) {}
+    void release();
+
+    Block* block_;
+    uint32_t head_;
+    uint32_t size_;
+};
+
+inline uint8_t* PacketBuffer::Block::payload() {
+    return reinterpret_cast<uint8_t*>(this) + HEADER_SIZE;
+}
+
+// Fixed-size block allocator behind PacketBuffer. Blocks are carved from
+// slabs and recycled through an intrusive free list, so once the pool has
+// grown to the working set acquiring a buffer never touches the heap.
+// Each thread keeps its own small cache of blocks per pool in front of the
+// shared list, so the pool lock is only taken to move a batch of blocks in
+// or out of a cache, not for every packet.
+// The pool must outlive every buffer it hands out.
+class BufferPool {
+public:
+    static constexpr size_t DEFAULT_HEADROOM = 64;     // Wire header and IV
+    static constexpr size_t DEFAULT_TAILROOM = 128;    // Cipher padding, tag and compression slack
+    static constexpr size_t BLOCKS_PER_SLAB = 64;
+    static constexpr size_t THREAD_CACHE_BLOCKS = 64;  // A cache spills half of these once full
+
+    BufferPool(size_t payloadSize, size_t headroom = DEFAULT_HEADROOM,
+               size_t tailroom = DEFAULT_TAILROOM, size_t initialBlocks = BLOCKS_PER_SLAB);
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Empty buffer with the configured headroom and room for at least payloadSize
+    // bytes plus tailroom; larger requests get a one-off heap block
+    PacketBuffer acquire(size_t payloadSize = 0);
+
+    size_t getBlockCapacity() const { return blockCapacity_; }
+    size_t getBlockCount() const;
+    size_t getFreeCount() const;        // Blocks on the shared list; thread caches hold more
+
+    // Process-wide pool for callers that are not tied to a NetworkManager
+    static BufferPool& getDefault();
+
+private:
+    friend class PacketBuffer;
+
+    struct ThreadCache;
+
+    // One pool's blocks cached by the calling thread
+    struct CacheSlot {
+        BufferPool* pool;
+        uint64_t poolId;
+        PacketBuffer::Block* blocks;
+        size_t count;
+    };
+
+    void grow(size_t blocks);
+    void recycle(PacketBuffer::Block* block);
+    CacheSlot& getCacheSlot();
+    void refill(CacheSlot& slot);
+    void spill(CacheSlot& slot, size_t count);
+    static void flush(CacheSlot& slot);
+
+    size_t blockCapacity_;
+    size_t blockStride_;
+    size_t headroom_;
+    size_t tailroom_;
+    uint64_t id_;               // Never reused, so a cache cannot mistake a new pool for a destroyed one
+
+    mutable std::mutex mutex_;
+    PacketBuffer::Block* freeList_;
+    size_t freeCount_;
+    std::vector<std::unique_ptr<uint8_t[]>> slabs_;
+};
+
+} // namespace BarrenEngine
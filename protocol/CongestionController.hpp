@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+
+namespace BarrenEngine {
+
+enum class CongestionAlgorithm {
+    CUBIC,      // Loss-based, RFC 9438
+    BBR,        // Model-based: paces at the measured bottleneck bandwidth
+    NONE        // No window and no pacing
+};
+
+// What one newly acknowledged packet tells the controller
+struct AckSample {
+    std::chrono::steady_clock::time_point now;
+    std::chrono::steady_clock::time_point sendTime;     // Of the copy that was acked last
+    size_t bytes;               // Size of the acked packet
+    size_t bytesInFlight;       // Before this ack was applied
+    float rtt;                  // Of this packet, 0 when it was resent and the sample is ambiguous
+    float smoothedRtt;          // 0 until the first sample
+    float deliveryRate;         // Bytes per second delivered while the packet was in flight, 0 when unknown
+    uint64_t delivered;         // Total bytes acked so far, this packet included
+    uint64_t deliveredAtSend;   // Total bytes acked when the packet was sent
+    bool appLimited;            // The rate reflects what the application sent, not what the path carries
+};
+
+// Send-side congestion state of one connection. Connection reports every
+// reliable packet acked or declared lost, and in return sends no more than
+// getCongestionWindow() bytes of them unacknowledged and spreads all of its
+// packets out at getPacingRate().
+class CongestionController {
+public:
+    virtual ~CongestionController() = default;
+
+    virtual void onAck(const AckSample& sample) = 0;
+    // sendTime is when the lost copy went out, so a burst of losses from
+    // one window counts as a single congestion event
+    virtual void onLoss(size_t bytes, std::chrono::steady_clock::time_point sendTime,
+                        std::chrono::steady_clock::time_point now) = 0;
+
+    virtual size_t getCongestionWindow() const = 0;
+    // Bytes per second, 0 while there is nothing to base a rate on
+    virtual float getPacingRate() const = 0;
+
+    // Returns nullptr for NONE
+    static std::unique_ptr<CongestionController> create(CongestionAlgorithm algorithm, size_t maxDatagramSize);
+
+protected:
+    static constexpr size_t INITIAL_WINDOW_PACKETS = 10;
+    static constexpr size_t MIN_WINDOW_PACKETS = 2;
+};
+
+// Grows the window along a cubic curve centred on the size it had at the
+// last loss, so it climbs back there quickly and probes beyond it carefully.
+class CubicController : public CongestionController {
+public:
+    explicit CubicController(size_t maxDatagramSize);
+
+    void onAck(const AckSample& sample) override;
+    void onLoss(size_t bytes, std::chrono::steady_clock::time_point sendTime,
+                std::chrono::steady_clock::time_point now) override;
+
+    size_t getCongestionWindow() const override { return static_cast<size_t>(window_); }
+    float getPacingRate() const override;
+
+private:
+    static constexpr double BETA = 0.7;     // Window kept on loss
+    static constexpr double C = 0.4;        // Curve scale in datagrams per second cubed
+
+    size_t maxDatagramSize_;
+    double window_;                         // Bytes
+    double slowStartThreshold_;
+    double windowAtLoss_;                   // W_max
+    double renoWindow_;                     // W_est, the Reno-friendly bound
+    double k_;                              // Seconds from the epoch start back up to W_max
+    std::chrono::steady_clock::time_point epochStart_;
+    std::chrono::steady_clock::time_point recoveryStart_;
+    bool inEpoch_;
+    float rtt_;
+};
+
+// Simplified BBR: estimates the bottleneck bandwidth as the best delivery
+// rate of the last rounds and the propagation delay as the lowest RTT seen,
+// and paces at gain * bandwidth. The window holds twice their product plus
+// the bytes the peer was seen to ack at once beyond what the bandwidth
+// explains, since the peer holds acks back and sends them in batches.
+// App-limited samples only ever raise the bandwidth. There is no PROBE_RTT
+// state; the minimum RTT simply expires after a while.
+class BbrController : public CongestionController {
+public:
+    explicit BbrController(size_t maxDatagramSize);
+
+    void onAck(const AckSample& sample) override;
+    void onLoss(size_t, std::chrono::steady_clock::time_point,
+                std::chrono::steady_clock::time_point) override {}
+
+    size_t getCongestionWindow() const override { return window_; }
+    float getPacingRate() const override;
+
+private:
+    enum class State { STARTUP, DRAIN, PROBE_BW };
+
+    static constexpr float STARTUP_GAIN = 2.885f;   // 2 / ln 2
+    static constexpr float WINDOW_GAIN = 2.0f;
+    static constexpr size_t BANDWIDTH_ROUNDS = 10;  // Window of the bandwidth and aggregation max filters
+    static constexpr size_t CYCLE_LENGTH = 8;
+    static constexpr float MIN_RTT_EXPIRY = 10.0f;  // Seconds
+    static constexpr size_t MIN_PIPE_PACKETS = 4;   // Keeps the ack clock going however small the estimate
+    static constexpr float MAX_AGGREGATION = 0.1f;  // Seconds of bandwidth the aggregation allowance may reach
+
+    void updateBandwidth(const AckSample& sample);
+    void updateAckAggregation(const AckSample& sample);
+    void updateWindow(const AckSample& sample);
+    float getBandwidth() const;
+    float getExtraAcked() const;
+    size_t getBdp(float gain) const;
+    size_t getTargetWindow(float gain) const;
+
+    size_t maxDatagramSize_;
+    State state_;
+    size_t window_;
+    float roundBandwidth_[BANDWIDTH_ROUNDS];        // Best sample of each recent round with one to take
+    size_t bandwidthSlot_;
+    bool bandwidthRoundPending_;                    // The next sample taken starts a new slot
+    float roundExtraAcked_[BANDWIDTH_ROUNDS];       // Largest ack aggregation of each recent round
+    std::chrono::steady_clock::time_point ackEpochStart_;
+    size_t ackEpochBytes_;                          // Acked since ackEpochStart_
+    uint64_t round_;
+    uint64_t nextRoundDelivered_;
+    float fullBandwidth_;                           // Startup ends when this stops growing
+    uint32_t fullBandwidthRounds_;
+    float minRtt_;
+    std::chrono::steady_clock::time_point minRttStamp_;
+    float nextMinRtt_;                              // Lowest sample since minRtt_ was set, 0 when none
+    size_t cycleIndex_;
+    std::chrono::steady_clock::time_point cycleStart_;
+    float pacingGain_;
+    size_t bytesInFlight_;
+};
+
+} // namespace BarrenEngine
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include "buffer/PacketBuffer.hpp"
+#include "protocol/WireHeader.hpp"
+#include "protocol/SequenceBuffer.hpp"
+
+namespace BarrenEngine {
+
+// Systematic Reed-Solomon erasure code over GF(256) with a Cauchy parity
+// matrix. Every K data packets of a group are followed by M parity packets,
+// and any K of the K + M rebuild the group. A symbol is a packet's header
+// (without acks or FEC fields) and payload behind a u16 length, padded with
+// zeros to the longest symbol of the group. With M = 1 the first parity
+// row reduces to plain XOR.
+class FecEncoder {
+public:
+    static constexpr uint8_t MAX_DATA_PACKETS = 15;
+    static constexpr uint8_t MAX_PARITY_PACKETS = 15;
+
+    // maxSymbolSize bounds the protected packets; larger ones go out unprotected
+    FecEncoder(BufferPool& pool, uint8_t dataCount, uint8_t parityCount, size_t maxSymbolSize);
+
+    // Stamps the header with its group and index and folds the packet into
+    // the parity. Returns false, leaving the header alone, when the packet is
+    // too large to protect.
+    bool addPacket(WireHeader& header, const PacketBuffer& payload);
+
+    // Once the group's last data packet was added, hands out its parity
+    // packets; the next addPacket starts a new group
+    bool isGroupComplete() const { return index_ == dataCount_; }
+    uint8_t getParityCount() const { return parityCount_; }
+    void takeParity(uint8_t parityIndex, WireHeader& header, PacketBuffer& data);
+
+private:
+    BufferPool& pool_;
+    uint8_t dataCount_;
+    uint8_t parityCount_;
+    size_t maxSymbolSize_;
+
+    uint16_t group_;
+    uint8_t index_;
+    size_t symbolSize_;                 // Longest symbol of the group so far
+    std::array<PacketBuffer, MAX_PARITY_PACKETS> parity_;
+};
+
+// Receiving side: collects the symbols of recent groups and rebuilds lost
+// data packets as soon as enough of their group has arrived.
+class FecDecoder {
+public:
+    static constexpr size_t GROUP_WINDOW = 8;
+
+    explicit FecDecoder(BufferPool& pool);
+
+    // Takes a FEC packet as received, before decryption. Each rebuilt data
+    // packet is appended to recovered as its header followed by its payload.
+    void addPacket(const WireHeader& header, const uint8_t* payload, size_t size,
+                   std::vector<PacketBuffer>& recovered);
+
+    size_t getRecoveredCount() const { return recoveredCount_; }
+
+private:
+    struct Group {
+        uint8_t dataCount = 0;
+        uint8_t parityCount = 0;
+        bool done = false;
+        std::array<PacketBuffer, FecEncoder::MAX_DATA_PACKETS + FecEncoder::MAX_PARITY_PACKETS> symbols;
+    };
+
+    void recover(Group& group, std::vector<PacketBuffer>& recovered);
+
+    BufferPool& pool_;
+    SequenceBuffer<Group, GROUP_WINDOW> groups_;
+    size_t recoveredCount_;
+};
+
+} // namespace BarrenEngine
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "buffer/PacketBuffer.hpp"
+
+namespace BarrenEngine {
+
+// Reassembles fragmented messages for one shard. The output buffer is
+// allocated once, when the first fragment of a message arrives, and every
+// fragment is copied straight to its final offset. Arrival is tracked in a
+// bitmap so duplicates are ignored. Messages that do not complete in time
+// are dropped from a FIFO of deadlines instead of by scanning every entry.
+//
+// Since a single forged first fragment reserves a whole message, the bytes
+// reserved by all pending messages are capped; a message that would go over
+// the budget is rejected until completions or expiry free enough of it.
+class FragmentAssembler {
+public:
+    enum class Result {
+        INCOMPLETE,     // Stored, more fragments outstanding
+        COMPLETE,       // Output holds the whole message
+        DUPLICATE,      // Fragment already received, ignored
+        REJECTED        // Inconsistent header or over a limit
+    };
+
+    static constexpr uint32_t DEFAULT_MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+    static constexpr uint32_t DEFAULT_TIMEOUT_MS = 5000;
+    static constexpr size_t MAX_PENDING_MESSAGES = 256;
+    static constexpr size_t DEFAULT_MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+    // maxPendingBytes is raised to maxMessageSize when below it (0 = default)
+    FragmentAssembler(BufferPool& pool, uint32_t fragmentSize, uint32_t maxMessageSize, uint32_t timeoutMs,
+                      size_t maxPendingBytes = 0);
+
+    // Fragments are keyed by sender and message id. Every fragment but the
+    // last must be exactly fragmentSize bytes.
+    Result addFragment(uint32_t clientId, uint32_t messageId, uint32_t fragmentIndex, uint32_t totalFragments,
+                       const uint8_t* data, size_t size, PacketBuffer& output,
+                       std::chrono::steady_clock::time_point now);
+
+    // Drop messages whose deadline has passed
+    void expire(std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::time_point getNextExpiry() const;
+
+    size_t getPendingCount() const { return pending_.size(); }
+    size_t getPendingBytes() const { return pendingBytes_; }
+    size_t getExpiredCount() const { return expiredCount_; }
+
+private:
+    struct PendingMessage {
+        PacketBuffer buffer;
+        std::vector<uint64_t> received;     // One bit per fragment
+        uint32_t totalFragments;
+        uint32_t receivedFragments;
+        uint32_t lastFragmentSize;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct Deadline {
+        std::chrono::steady_clock::time_point time;
+        uint64_t key;
+    };
+
+    static uint64_t makeKey(uint32_t clientId, uint32_t messageId) {
+        return (static_cast<uint64_t>(clientId) << 32) | messageId;
+    }
+
+    BufferPool& pool_;
+    uint32_t fragmentSize_;
+    uint32_t maxMessageSize_;
+    std::chrono::milliseconds timeout_;
+    size_t maxPendingBytes_;
+    size_t pendingBytes_;                   // Reserved by the output buffers of pending_
+
+    std::unordered_map<uint64_t, PendingMessage> pending_;
+    std::deque<Deadline> deadlines_;        // The timeout is fixed, so insertion order is expiry order
+    size_t expiredCount_;
+};
+
+} // namespace BarrenEngine
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "protocol/SequenceBuffer.hpp"
+
+namespace BarrenEngine {
+
+// Anti-replay window over 16-bit sequences, after RFC 4303 appendix A: one
+// bit for each of the N sequences up to the newest received. Anything newer
+// is fresh, anything older than the window is stale, and in between the bit
+// tells a duplicate. The bit for a sequence lives at sequence % N, so
+// sliding forward only clears the bits passed over, and each is cleared
+// once per lap. N must be a multiple of 64 that divides the sequence space.
+template <size_t N>
+class ReplayWindow {
+    static_assert(N >= 64 && N <= 0x8000 && (N & (N - 1)) == 0, "N must be a power of two from 64 to 32768");
+
+public:
+    enum class Result {
+        FRESH,
+        DUPLICATE,
+        STALE       // Too old to tell, treated as a duplicate
+    };
+
+    ReplayWindow() { reset(); }
+
+    void reset() {
+        bits_.fill(0);
+        newest_ = 0;
+        empty_ = true;
+    }
+
+    Result check(uint16_t sequence) const {
+        if (empty_ || sequenceGreaterThan(sequence, newest_)) {
+            return Result::FRESH;
+        }
+        if (static_cast<uint16_t>(newest_ - sequence) >= N) {
+            return Result::STALE;
+        }
+        return test(sequence) ? Result::DUPLICATE : Result::FRESH;
+    }
+
+    // Records a fresh sequence, sliding the window when it is the newest yet,
+    // and returns what check() said beforehand
+    Result insert(uint16_t sequence) {
+        Result result = check(sequence);
+        if (result != Result::FRESH) {
+            return result;
+        }
+
+        if (empty_) {
+            empty_ = false;
+            newest_ = sequence;
+        } else if (sequenceGreaterThan(sequence, newest_)) {
+            uint16_t gap = static_cast<uint16_t>(sequence - newest_);
+            if (gap >= N) {
+                bits_.fill(0);
+            } else {
+                for (uint16_t i = 1; i < gap; ++i) {
+                    clear(static_cast<uint16_t>(newest_ + i));
+                }
+            }
+            newest_ = sequence;
+        }
+        set(sequence);
+        return Result::FRESH;
+    }
+
+    bool contains(uint16_t sequence) const {
+        return !empty_ && static_cast<uint16_t>(newest_ - sequence) < N && test(sequence);
+    }
+
+    bool empty() const { return empty_; }
+    uint16_t getNewest() const { return newest_; }
+
+private:
+    bool test(uint16_t sequence) const {
+        size_t bit = sequence % N;
+        return (bits_[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    void set(uint16_t sequence) {
+        size_t bit = sequence % N;
+        bits_[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+
+    void clear(uint16_t sequence) {
+        size_t bit = sequence % N;
+        bits_[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+    }
+
+    std::array<uint64_t, N / 64> bits_;
+    uint16_t newest_;
+    bool empty_;
+};
+
+} // namespace BarrenEngine
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace BarrenEngine {
+
+// Wrap-aware ordering of 16-bit sequence numbers: a is newer than b when it
+// is ahead by less than half the sequence space
+inline bool sequenceGreaterThan(uint16_t a, uint16_t b) {
+    return static_cast<uint16_t>(a - b) != 0 && static_cast<uint16_t>(a - b) < 0x8000;
+}
+
+inline bool sequenceLessThan(uint16_t a, uint16_t b) {
+    return sequenceGreaterThan(b, a);
+}
+
+// Fixed-size window of per-sequence entries, stored at sequence % N. Each
+// slot remembers which sequence it currently holds, so a lookup is a single
+// index and compare and an entry from a previous lap reads as absent.
+// N must divide the 16-bit sequence space so slots line up across the wrap.
+template <typename T, size_t N>
+class SequenceBuffer {
+    static_assert(N > 0 && N <= 0x10000 && (N & (N - 1)) == 0, "N must be a power of two up to 65536");
+
+public:
+    SequenceBuffer() { reset(); }
+
+    void reset() {
+        sequences_.fill(EMPTY);
+    }
+
+    // Claims the slot for sequence, evicting whatever it held, and returns a
+    // value-initialized entry
+    T& insert(uint16_t sequence) {
+        size_t index = sequence % N;
+        sequences_[index] = sequence;
+        entries_[index] = T();
+        return entries_[index];
+    }
+
+    void remove(uint16_t sequence) {
+        size_t index = sequence % N;
+        if (sequences_[index] == sequence) {
+            sequences_[index] = EMPTY;
+        }
+    }
+
+    bool exists(uint16_t sequence) const {
+        return sequences_[sequence % N] == sequence;
+    }
+
+    T* find(uint16_t sequence) {
+        size_t index = sequence % N;
+        return sequences_[index] == sequence ? &entries_[index] : nullptr;
+    }
+
+    const T* find(uint16_t sequence) const {
+        size_t index = sequence % N;
+        return sequences_[index] == sequence ? &entries_[index] : nullptr;
+    }
+
+    static constexpr size_t size() { return N; }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    std::array<uint32_t, N> sequences_;
+    std::array<T, N> entries_;
+};
+
+} // namespace BarrenEngine
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace BarrenEngine {
+
+// Per-packet header written in front of the (possibly encrypted) payload.
+//
+//   byte 0   version:2 | reliability:3 | ACK:1 | FRAGMENT:1 | EXTENDED:1
+//   byte 1   flags (COMPRESSED, ENCRYPTED, BUNDLE, FEC), only when EXTENDED is set
+//   u16      sequence, for every reliability but UNRELIABLE
+//   u8 u16   channel and orderSequence, for the sequenced and ordered modes
+//   u16 u8 u8  fecGroup, fecIndex, fecDataCount:4 | fecParityCount:4, when FEC is set
+//   u16 u32  ack and ackBits, when ACK is set
+//   varint   messageId, fragmentIndex, totalFragments, when FRAGMENT is set
+//
+// An unreliable, unfragmented, plain packet costs a single byte. All
+// integers are little-endian; encode and decode work on caller memory.
+//
+// A BUNDLE packet carries only acks itself; its body is a run of entries,
+// each a u16 length followed by a complete packet without acks.
+struct WireHeader {
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t MAX_SIZE = 2 + 2 + 3 + 4 + 6 + 3 * 5;
+
+    // Flags carried in the extension byte
+    static constexpr uint8_t COMPRESSED = 0x01;
+    static constexpr uint8_t ENCRYPTED = 0x02;
+    static constexpr uint8_t BUNDLE = 0x04;
+    static constexpr uint8_t FEC = 0x08;
+    static constexpr size_t BUNDLE_LENGTH_SIZE = 2;
+
+    uint8_t reliability = 0;      // PacketReliability value
+    uint8_t flags = 0;
+    bool hasAck = false;
+    uint16_t sequence = 0;
+    uint8_t channel = 0;
+    uint16_t orderSequence = 0;   // Per channel, counted separately for sequenced and ordered packets
+    uint16_t fecGroup = 0;
+    uint8_t fecIndex = 0;         // Data packets come first, parity packets from fecDataCount on
+    uint8_t fecDataCount = 0;
+    uint8_t fecParityCount = 0;
+    uint16_t ack = 0;             // Most recent sequence received from the peer
+    uint32_t ackBits = 0;         // Bit n set: ack - n - 1 was received as well
+    bool isFragment = false;
+    uint32_t messageId = 0;
+    uint32_t fragmentIndex = 0;
+    uint32_t totalFragments = 0;
+
+    bool hasSequence() const { return reliability != 0; }
+    bool hasOrdering() const { return reliability == 1 || reliability == 3 || reliability == 4; } // *_SEQUENCED, RELIABLE_ORDERED
+    size_t getEncodedSize() const;
+
+    // Return the number of bytes written or consumed, 0 when there is not enough
+    // room, the input is truncated or malformed, or the version is unknown
+    size_t encode(uint8_t* output, size_t capacity) const;
+    size_t decode(const uint8_t* data, size_t size);
+};
+
+} // namespace BarrenEngine
@@ -2,57 +2,88 @@
 #include <lz4.h>
 #include <zstd.h>
 #include <algorithm>
+#include <cstring>
+#include <memory>
 
 namespace BarrenEngine {
 
 std::vector<uint8_t> Compression::compress(const std::vector<uint8_t>& data, Algorithm algorithm) {
-    if (data.empty() || !shouldCompress(data, algorithm)) {
+    if (data.empty()) {
         return data;
     }
 
+    std::vector<uint8_t> compressed(compressBound(data.size(), algorithm));
+    const size_t compressedSize = compress(data.data(), data.size(), compressed.data(), compressed.size(), algorithm);
+    if (compressedSize == 0) {
+        return data;
+    }
+
+    compressed.resize(compressedSize);
+    return compressed;
+}
+
+size_t Compression::compress(const uint8_t* data, size_t size, uint8_t* output, size_t capacity, Algorithm algorithm) {
+    if (size < MIN_COMPRESSION_SIZE) {
+        return 0;
+    }
+
+    // Anything at or above the threshold is not worth the receiver's decompression
+    const size_t limit = static_cast<size_t>(size * COMPRESSION_RATIO_THRESHOLD);
+    size_t compressedSize = 0;
+
     switch (algorithm) {
         case Algorithm::LZ4: {
-            const int maxCompressedSize = LZ4_compressBound(data.size());
-            std::vector<uint8_t> compressed(maxCompressedSize);
-            
-            const int compressedSize = LZ4_compress_default(
-                reinterpret_cast<const char*>(data.data()),
-                reinterpret_cast<char*>(compressed.data()),
-                data.size(),
-                maxCompressedSize
+            if (capacity <= LZ4_SIZE_PREFIX) return 0;
+
+            const int result = LZ4_compress_default(
+                reinterpret_cast<const char*>(data),
+                reinterpret_cast<char*>(output + LZ4_SIZE_PREFIX),
+                static_cast<int>(size),
+                static_cast<int>(std::min<size_t>(capacity - LZ4_SIZE_PREFIX, limit))
             );
+            if (result <= 0) return 0;
 
-            if (compressedSize > 0) {
-                compressed.resize(compressedSize);
-                return compressed;
-            }
+            const uint32_t originalSize = static_cast<uint32_t>(size);
+            std::memcpy(output, &originalSize, LZ4_SIZE_PREFIX);
+            compressedSize = LZ4_SIZE_PREFIX + static_cast<size_t>(result);
             break;
         }
 
         case Algorithm::ZSTD: {
-            const size_t maxCompressedSize = ZSTD_compressBound(data.size());
-            std::vector<uint8_t> compressed(maxCompressedSize);
-            
-            const size_t compressedSize = ZSTD_compress(
-                compressed.data(),
-                maxCompressedSize,
-                data.data(),
-                data.size(),
+            // One context per thread; ZSTD_compress would allocate a fresh one per call
+            thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+            if (!context) return 0;
+
+            const size_t result = ZSTD_compressCCtx(
+                context.get(),
+                output,
+                capacity,
+                data,
+                size,
                 3  // Compression level (1-22, higher = better compression but slower)
             );
+            if (ZSTD_isError(result)) return 0;
 
-            if (!ZSTD_isError(compressedSize)) {
-                compressed.resize(compressedSize);
-                return compressed;
-            }
+            compressedSize = result;
             break;
         }
 
         default:
-            break;
+            return 0;
     }
 
-    return data;
+    return compressedSize < limit ? compressedSize : 0;
+}
+
+size_t Compression::compressBound(size_t size, Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::LZ4:
+            return LZ4_SIZE_PREFIX + static_cast<size_t>(LZ4_compressBound(static_cast<int>(size)));
+        case Algorithm::ZSTD:
+            return ZSTD_compressBound(size);
+        default:
+            return size;
+    }
 }
 
 std::vector<uint8_t> Compression::decompress(const std::vector<uint8_t>& compressedData, Algorithm algorithm) {
@@ -108,16 +139,67 @@ std::vector<uint8_t> Compression::decompress(const std::vector<uint8_t>& compres
     return compressedData;
 }
 
+size_t Compression::decompress(const uint8_t* data, size_t size, uint8_t* output, size_t capacity, Algorithm algorithm) {
+    const size_t originalSize = getDecompressedSize(data, size, algorithm);
+    if (originalSize == 0 || originalSize > capacity) {
+        return 0;
+    }
+
+    switch (algorithm) {
+        case Algorithm::LZ4: {
+            const int result = LZ4_decompress_safe(
+                reinterpret_cast<const char*>(data + LZ4_SIZE_PREFIX),
+                reinterpret_cast<char*>(output),
+                static_cast<int>(size - LZ4_SIZE_PREFIX),
+                static_cast<int>(originalSize)
+            );
+            return result > 0 ? static_cast<size_t>(result) : 0;
+        }
+
+        case Algorithm::ZSTD: {
+            // Same per-thread reuse as compression; ZSTD_decompress allocates a context per call
+            thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+            if (!context) return 0;
+
+            const size_t result = ZSTD_decompressDCtx(context.get(), output, originalSize, data, size);
+            return ZSTD_isError(result) ? 0 : result;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+size_t Compression::getDecompressedSize(const uint8_t* data, size_t size, Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::LZ4: {
+            if (size <= LZ4_SIZE_PREFIX) return 0;
+            uint32_t originalSize;
+            std::memcpy(&originalSize, data, LZ4_SIZE_PREFIX);
+            return originalSize;
+        }
+
+        case Algorithm::ZSTD: {
+            const unsigned long long originalSize = ZSTD_getFrameContentSize(data, size);
+            if (originalSize == ZSTD_CONTENTSIZE_ERROR || originalSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+                return 0;
+            }
+            return static_cast<size_t>(originalSize);
+        }
+
+        default:
+            return 0;
+    }
+}
+
 bool Compression::shouldCompress(const std::vector<uint8_t>& data, Algorithm algorithm) {
     if (data.size() < MIN_COMPRESSION_SIZE) {
         return false;
     }
 
-    // Try compression and check ratio
-    std::vector<uint8_t> compressed = compress(data, algorithm);
-    float ratio = static_cast<float>(compressed.size()) / data.size();
-    
-    return ratio < COMPRESSION_RATIO_THRESHOLD;
+    // Try compression; the buffer variant already applies the ratio threshold
+    std::vector<uint8_t> compressed(compressBound(data.size(), algorithm));
+    return compress(data.data(), data.size(), compressed.data(), compressed.size(), algorithm) > 0;
 }
 
 } // namespace BarrenEngine 
\ No newline at end of file
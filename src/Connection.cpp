@@ -1,141 +1,740 @@
 #include "Connection.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 namespace BarrenEngine {
 
-Connection::Connection(uint32_t maxPacketSize)
-    : nextSequenceNumber_(0)
+namespace {
+
+bool isReliable(PacketReliability reliability) {
+    return reliability == PacketReliability::RELIABLE ||
+           reliability == PacketReliability::RELIABLE_SEQUENCED ||
+           reliability == PacketReliability::RELIABLE_ORDERED;
+}
+
+std::chrono::steady_clock::duration toDuration(float seconds) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float>(seconds));
+}
+
+} // namespace
+
+Connection::Connection(uint32_t maxPacketSize, BufferPool* bufferPool)
+    : bufferPool_(bufferPool ? bufferPool : &BufferPool::getDefault())
+    , nextSequence_(0)
+    , oldestUnacknowledged_(0)
+    , largestAcknowledged_(0)
+    , hasLargestAcknowledged_(false)
+    , lossScanSequence_(0)
+    , ackPending_(false)
+    , receivedSinceAck_(0)
+    , keepAlivePending_(false)
     , maxPacketSize_(maxPacketSize)
     , connected_(false)
     , rtt_(0.0f)
+    , rttVariance_(0.0f)
+    , rto_(INITIAL_RTO)
+    , hasRttSample_(false)
     , packetLoss_(0.0f)
+    , bytesInFlight_(0)
+    , delivered_(0)
+    , appLimitedUntil_(0)
+    , pacingCredit_(0.0f)
+    , pacingBlocked_(false)
     , packetsSent_(0)
     , packetsReceived_(0)
     , packetsLost_(0)
+    , fastRetransmits_(0)
+    , fecRecovered_(0)
+    , duplicatesDropped_(0)
+    , packetsDropped_(0)
     , lastStatsUpdate_(std::chrono::steady_clock::now())
 {
+    congestion_ = CongestionController::create(CongestionAlgorithm::CUBIC, maxPacketSize_);
+    pacingUpdate_ = lastStatsUpdate_;
 }
 
 Connection::~Connection() {
     std::lock_guard<std::mutex> lock(packetMutex_);
-    unacknowledgedPackets_.clear();
-    while (!outgoingPackets_.empty()) {
-        outgoingPackets_.pop();
-    }
+    outgoingPackets_.clear();
+}
+
+void Connection::queuePacket(const std::vector<uint8_t>& data, PacketReliability reliability, uint8_t channel) {
+    PacketBuffer buffer = bufferPool_->acquire(data.size());
+    buffer.append(data.data(), data.size());
+    queuePacket(std::move(buffer), reliability, channel);
 }
 
-void Connection::queuePacket(const std::vector<uint8_t>& data, PacketReliability reliability) {
+void Connection::queuePacket(PacketBuffer data, PacketReliability reliability, uint8_t channel,
+                             const WireHeader& header) {
+    if (channel >= MAX_CHANNELS) {
+        std::cerr << "Invalid channel " << static_cast<int>(channel) << std::endl;
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(packetMutex_);
-    
+
     Packet packet;
-    packet.sequenceNumber = nextSequenceNumber_++;
+    packet.sequenceNumber = 0;
     packet.timestamp = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count());
     packet.reliability = reliability;
-    packet.data = data;
+    packet.data = std::move(data);
+    packet.header = header;
+    packet.header.reliability = static_cast<uint8_t>(reliability);
     packet.isAcknowledged = false;
-    packet.lastResendTime = std::chrono::steady_clock::now();
+    packet.resendCount = 0;
+    packet.sendTime = std::chrono::steady_clock::now();
+    packet.lastResendTime = packet.sendTime;
 
-    if (reliability == PacketReliability::UNRELIABLE) {
-        outgoingPackets_.push(packet);
-    } else {
-        unacknowledgedPackets_[packet.sequenceNumber] = packet;
+    // Order sequences follow queue order; ordered packets count separately so
+    // a lost sequenced packet never leaves a gap the ordered stream waits on
+    if (packet.header.hasOrdering()) {
+        Channel& state = channels_[channel];
+        packet.header.channel = channel;
+        packet.header.orderSequence = reliability == PacketReliability::RELIABLE_ORDERED
+            ? state.nextOrderedSequence++ : state.nextSequencedSequence++;
+    }
+
+    // Unreliable packets are worth less the longer they wait, so a full queue
+    // sheds the oldest of them. Reliable ones are never dropped here.
+    if (outgoingPackets_.size() >= MAX_OUTGOING_PACKETS) {
+        auto oldest = std::find_if(outgoingPackets_.begin(), outgoingPackets_.end(),
+                                   [](const Packet& queued) { return !isReliable(queued.reliability); });
+        if (oldest != outgoingPackets_.end()) {
+            outgoingPackets_.erase(oldest);
+            packetsDropped_++;
+        } else if (!isReliable(reliability)) {
+            packetsDropped_++;
+            return;
+        }
     }
+
+    outgoingPackets_.push_back(std::move(packet));
 }
 
-bool Connection::processIncomingPacket(const std::vector<uint8_t>& data) {
-    if (data.size() < sizeof(uint32_t)) {
-        return false;
+void Connection::enableFec(uint8_t dataPackets, uint8_t parityPackets) {
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    if (dataPackets == 0) {
+        fecEncoder_.reset();
+        return;
     }
+    // Protected packets leave room for the parity header around the same symbol
+    size_t maxSymbolSize = maxPacketSize_ > WireHeader::MAX_SIZE ? maxPacketSize_ - WireHeader::MAX_SIZE : 0;
+    fecEncoder_ = std::make_unique<FecEncoder>(*bufferPool_, dataPackets, parityPackets, maxSymbolSize);
+}
+
+void Connection::setCongestionControl(CongestionAlgorithm algorithm) {
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    congestion_ = CongestionController::create(algorithm, maxPacketSize_);
+}
 
-    // Extract sequence number from the first 4 bytes
-    uint32_t sequenceNumber = *reinterpret_cast<const uint32_t*>(data.data());
-    
-    // Send acknowledgment
-    std::vector<uint8_t> ackData(sizeof(uint32_t));
-    *reinterpret_cast<uint32_t*>(ackData.data()) = sequenceNumber;
-    queuePacket(ackData, PacketReliability::UNRELIABLE);
+void Connection::recoverFecPackets(const WireHeader& header, const uint8_t* payload, size_t size,
+                                   std::vector<PacketBuffer>& recovered) {
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    if (!fecDecoder_) {
+        fecDecoder_ = std::make_unique<FecDecoder>(*bufferPool_);
+    }
+    fecDecoder_->addPacket(header, payload, size, recovered);
+    fecRecovered_ = static_cast<uint32_t>(fecDecoder_->getRecoveredCount());
+}
 
-    // Process the actual packet data
+void Connection::processIncomingPacket(const WireHeader& header, PacketBuffer data,
+                                       std::vector<InboundPacket>& released, bool recovered) {
     std::lock_guard<std::mutex> lock(packetMutex_);
     packetsReceived_++;
 
-    // Handle acknowledgment if this is an ack packet
-    if (data.size() == sizeof(uint32_t)) {
-        handleAcknowledgment(sequenceNumber);
-        return true;
+    if (header.hasAck) {
+        auto now = std::chrono::steady_clock::now();
+        handleAcknowledgment(header.ack, now);
+        for (uint32_t i = 0; i < ACK_BITS; ++i) {
+            if (header.ackBits & (1u << i)) {
+                handleAcknowledgment(static_cast<uint16_t>(header.ack - i - 1), now);
+            }
+        }
+        detectLosses(now);
     }
 
+    if (header.hasSequence() && !acceptSequence(header.sequence)) {
+        return;
+    }
+
+    if (!data.empty()) {
+        releaseInOrder(header, std::move(data), released, recovered);
+    }
+}
+
+bool Connection::isDuplicate(const WireHeader& header) {
+    if (!header.hasSequence()) return false;
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    return receivedWindow_.check(header.sequence) != ReplayWindow<RECEIVED_BUFFER_SIZE>::Result::FRESH;
+}
+
+bool Connection::acceptSequence(uint16_t sequence) {
+    auto result = receivedWindow_.insert(sequence);
+    if (result == ReplayWindow<RECEIVED_BUFFER_SIZE>::Result::STALE) {
+        duplicatesDropped_++;
+        return false;
+    }
+
+    if (!ackPending_) {
+        ackPending_ = true;
+        ackDeadline_ = std::chrono::steady_clock::now() + toDuration(ACK_DELAY);
+    }
+
+    uint16_t newest = receivedWindow_.getNewest();
+    if (result == ReplayWindow<RECEIVED_BUFFER_SIZE>::Result::DUPLICATE) {
+        // The peer resent because our ack was lost; one beyond the bitfield needs an ack of its own
+        if (static_cast<uint16_t>(newest - sequence) > ACK_BITS &&
+            explicitAcks_.size() < MAX_EXPLICIT_ACKS) {
+            explicitAcks_.push_back(sequence);
+        }
+        duplicatesDropped_++;
+        return false;
+    }
+
+    // A burst longer than the bitfield would push its start out of the next
+    // header's acks, so ack each full window on its own
+    if (++receivedSinceAck_ > ACK_BITS) {
+        if (explicitAcks_.size() < MAX_EXPLICIT_ACKS) {
+            explicitAcks_.push_back(newest);
+        }
+        receivedSinceAck_ = 0;
+    }
     return true;
 }
 
+void Connection::releaseInOrder(const WireHeader& header, PacketBuffer data, std::vector<InboundPacket>& released,
+                                bool recovered) {
+    if (!header.hasOrdering()) {
+        released.push_back({ header, std::move(data) });
+        return;
+    }
+    if (header.channel >= MAX_CHANNELS) {
+        return;
+    }
+
+    Channel& channel = channels_[header.channel];
+    uint16_t orderSequence = header.orderSequence;
+
+    // Sequenced: anything older than the newest already delivered is stale,
+    // unless FEC rebuilt it, which only happens once later packets arrived
+    if (header.reliability != static_cast<uint8_t>(PacketReliability::RELIABLE_ORDERED)) {
+        if (recovered) {
+            released.push_back({ header, std::move(data) });
+            return;
+        }
+        if (channel.hasSequenced && !sequenceGreaterThan(orderSequence, channel.newestSequencedSequence)) {
+            return;
+        }
+        channel.newestSequencedSequence = orderSequence;
+        channel.hasSequenced = true;
+        released.push_back({ header, std::move(data) });
+        return;
+    }
+
+    // Ordered: hold packets that arrive early until the gap before them fills
+    if (orderSequence != channel.expectedOrderedSequence) {
+        uint16_t distance = static_cast<uint16_t>(orderSequence - channel.expectedOrderedSequence);
+        if (sequenceLessThan(orderSequence, channel.expectedOrderedSequence) || distance >= REORDER_BUFFER_SIZE) {
+            return;
+        }
+        if (!channel.reorderBuffer) {
+            channel.reorderBuffer = std::make_unique<SequenceBuffer<InboundPacket, REORDER_BUFFER_SIZE>>();
+        }
+        InboundPacket& pending = channel.reorderBuffer->insert(orderSequence);
+        pending.header = header;
+        pending.data = std::move(data);
+        return;
+    }
+
+    released.push_back({ header, std::move(data) });
+    channel.expectedOrderedSequence++;
+
+    if (!channel.reorderBuffer) return;
+    while (InboundPacket* pending = channel.reorderBuffer->find(channel.expectedOrderedSequence)) {
+        released.push_back(std::move(*pending));
+        channel.reorderBuffer->remove(channel.expectedOrderedSequence);
+        channel.expectedOrderedSequence++;
+    }
+}
+
+void Connection::queueKeepAlive() {
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    keepAlivePending_ = connected_;
+}
+
 std::vector<Packet> Connection::getPacketsToSend() {
+    std::vector<Packet> datagrams;
+    getPacketsToSend(datagrams);
+    return datagrams;
+}
+
+void Connection::getPacketsToSend(std::vector<Packet>& datagrams) {
     std::lock_guard<std::mutex> lock(packetMutex_);
-    std::vector<Packet> packets;
+    if (!connected_) return;
+    std::vector<Packet>& packets = flushPackets_;
+    packets.clear();
+    auto now = std::chrono::steady_clock::now();
+    refillPacingCredit(now);
+    pacingBlocked_ = false;
+
+    // Resend the reliable packets whose timer has expired; the rest are not
+    // touched. The copies share the stored block, so the payload window kept
+    // for later resends is never modified.
+    while (!resendTimers_.empty() && resendTimers_.top().deadline <= now) {
+        ResendTimer timer = resendTimers_.top();
+        resendTimers_.pop();
+        if (!isResendTimerCurrent(timer)) continue;
+
+        // A peer that let every attempt time out is gone
+        Packet* packet = sentPackets_.find(timer.sequence);
+        if (packet->resendCount >= MAX_RESEND_ATTEMPTS) {
+            failConnection();
+            return;
+        }
+
+        // The copy in flight counts as lost; the resend is in flight again
+        if (congestion_ && packet->flightSize > 0) {
+            congestion_->onLoss(packet->flightSize, packet->lastResendTime, now);
+        }
+        removeFromFlight(*packet);
+        packet->lastResendTime = now;
+        packet->resendCount++;
+        scheduleResend(*packet, now);
+        addToFlight(*packet, now);
+        pacingCredit_ -= static_cast<float>(packet->flightSize);
+        packets.push_back(*packet);
+        packetsLost_++;
+    }
+    advanceOldestUnacknowledged();
+
+    // Sequence the queued packets. A reliable packet occupies its slot until
+    // acked, so once the window is full sequenced packets wait for the next
+    // flush; so do reliable ones while the congestion window is, or once the
+    // pacer runs out of credit. Resends above are exempt. Unreliable packets
+    // never feed the rate estimate, so they are not paced either.
+    bool paced = congestion_ && congestion_->getPacingRate() > 0.0f;
+    bool congested = false;
+    size_t kept = 0;
+    for (auto& packet : outgoingPackets_) {
+        bool reliable = isReliable(packet.reliability);
+        congested = congested || (reliable && isCongestionLimited(packet));
+        bool windowFull = packet.header.hasSequence() &&
+                          static_cast<uint16_t>(nextSequence_ - oldestUnacknowledged_) >= SENT_BUFFER_SIZE;
+        bool pacingLimited = reliable && paced && pacingCredit_ <= 0.0f;
+        if (pacingLimited || windowFull || (congested && reliable)) {
+            pacingBlocked_ = pacingBlocked_ || pacingLimited;
+            if (&outgoingPackets_[kept] != &packet) {
+                outgoingPackets_[kept] = std::move(packet);
+            }
+            kept++;
+            continue;
+        }
+
+        if (packet.header.hasSequence()) {
+            packet.sequenceNumber = nextSequence_++;
+            packet.header.sequence = static_cast<uint16_t>(packet.sequenceNumber);
+            packet.sendTime = now;
+            packet.lastResendTime = now;
+
+            Packet& sent = sentPackets_.insert(packet.header.sequence);
+            if (isReliable(packet.reliability)) {
+                addToFlight(packet, now);
+                sent = packet;
+                scheduleResend(sent, now);
+            } else {
+                sent.sequenceNumber = packet.sequenceNumber;
+                sent.reliability = packet.reliability;
+                sent.isAcknowledged = false;
+                sent.resendCount = 0;
+                sent.sendTime = now;
+            }
+        }
+
+        if (reliable) {
+            pacingCredit_ -= static_cast<float>(packet.flightSize);
+        }
 
-    // Get all unacknowledged packets that need to be resent
-    for (auto& pair : unacknowledgedPackets_) {
-        if (shouldResendPacket(pair.second)) {
-            packets.push_back(pair.second);
-            pair.second.lastResendTime = std::chrono::steady_clock::now();
+        // Parity follows the packet that completes its group
+        bool protect = fecEncoder_ && packet.reliability == PacketReliability::UNRELIABLE_SEQUENCED &&
+                       fecEncoder_->addPacket(packet.header, packet.data);
+        packets.push_back(std::move(packet));
+        if (protect && fecEncoder_->isGroupComplete()) {
+            appendParityPackets(packets);
         }
     }
+    outgoingPackets_.resize(kept);
+
+    // Nothing held back and room left in the window: the application, not
+    // the path, sets the pace until what is in flight now is delivered
+    if (congestion_ && kept == 0 && bytesInFlight_ < congestion_->getCongestionWindow()) {
+        appLimitedUntil_ = std::max<uint64_t>(delivered_ + bytesInFlight_, 1);
+    }
 
-    // Get all queued packets
-    while (!outgoingPackets_.empty()) {
-        packets.push_back(outgoingPackets_.front());
-        outgoingPackets_.pop();
+    if (pacingBlocked_) {
+        // Wake up once a full datagram's worth of credit has built up again
+        float rate = congestion_->getPacingRate();
+        pacingResume_ = now + toDuration((static_cast<float>(maxPacketSize_) - pacingCredit_) / rate);
     }
 
-    return packets;
+    // Every header carries the current acks; a bare ack goes out only when
+    // there was nothing to piggyback on for ACK_DELAY
+    if (ackPending_ && (!packets.empty() || now >= ackDeadline_)) {
+        if (packets.empty()) {
+            packets.push_back(makeAckPacket(receivedWindow_.getNewest()));
+        }
+        ackPending_ = false;
+        receivedSinceAck_ = 0;
+    }
+
+    // A keep-alive is a bare header too, needed only when nothing else goes out
+    if (keepAlivePending_ && packets.empty()) {
+        Packet keepAlive = makeAckPacket(0);
+        keepAlive.header.hasAck = false;   // Filled in below if there is anything to ack
+        packets.push_back(std::move(keepAlive));
+    }
+    keepAlivePending_ = false;
+
+    bool hasRemoteSequence = !receivedWindow_.empty();
+    uint16_t remoteSequence = receivedWindow_.getNewest();
+    uint32_t ackBits = hasRemoteSequence ? getAckBits(remoteSequence) : 0;
+    for (auto& packet : packets) {
+        if (!packet.header.hasAck && hasRemoteSequence) {
+            packet.header.hasAck = true;
+            packet.header.ack = remoteSequence;
+            packet.header.ackBits = ackBits;
+        }
+    }
+
+    for (uint16_t ack : explicitAcks_) {
+        packets.push_back(makeAckPacket(ack));
+    }
+    explicitAcks_.clear();
+
+    packetsSent_ += static_cast<uint32_t>(packets.size());
+    coalescePackets(packets, datagrams);
+
+    // Bundled packets were copied into their bundle; let go of their blocks
+    packets.clear();
 }
 
 void Connection::update(float deltaTime) {
     std::lock_guard<std::mutex> lock(packetMutex_);
-    
+
     // Update statistics
     auto now = std::chrono::steady_clock::now();
-    if (std::chrono::duration_cast<std::chrono::seconds>(now - lastStatsUpdate_).count() >= 1) {
+    if (now - lastStatsUpdate_ >= toDuration(STATS_UPDATE_INTERVAL)) {
         updateStatistics();
         lastStatsUpdate_ = now;
     }
+}
+
+std::chrono::steady_clock::time_point Connection::getNextSendTime() {
+    std::lock_guard<std::mutex> lock(packetMutex_);
+    auto next = std::chrono::steady_clock::time_point::max();
+    if (!explicitAcks_.empty() || keepAlivePending_) {
+        next = std::chrono::steady_clock::now();
+    } else if (ackPending_) {
+        next = ackDeadline_;
+    }
+    if (pacingBlocked_) {
+        next = std::min(next, pacingResume_);
+    }
 
-    // Resend unacknowledged packets
-    resendUnacknowledgedPackets();
+    // Drop stale timers so an acked packet does not cause an early wakeup
+    while (!resendTimers_.empty() && !isResendTimerCurrent(resendTimers_.top())) {
+        resendTimers_.pop();
+    }
+    if (!resendTimers_.empty()) {
+        next = std::min(next, resendTimers_.top().deadline);
+    }
+    return next;
 }
 
-void Connection::handleAcknowledgment(uint32_t sequenceNumber) {
-    auto it = unacknowledgedPackets_.find(sequenceNumber);
-    if (it != unacknowledgedPackets_.end()) {
-        it->second.isAcknowledged = true;
-        unacknowledgedPackets_.erase(it);
+void Connection::handleAcknowledgment(uint16_t sequence, std::chrono::steady_clock::time_point now) {
+    Packet* packet = sentPackets_.find(sequence);
+    if (packet && !packet->isAcknowledged) {
+        packet->isAcknowledged = true;
+        if (!hasLargestAcknowledged_ || sequenceGreaterThan(sequence, largestAcknowledged_)) {
+            largestAcknowledged_ = sequence;
+            hasLargestAcknowledged_ = true;
+        }
+        packet->data.reset();   // Return the block kept for resends to the pool
+
+        // Karn's rule: an ack for a resent packet cannot tell which copy it answers
+        float rtt = 0.0f;
+        if (packet->resendCount == 0) {
+            rtt = std::chrono::duration<float>(now - packet->sendTime).count();
+            updateRoundTripTime(rtt);
+        }
+
+        if (packet->flightSize > 0) {
+            AckSample sample{};
+            sample.now = now;
+            sample.sendTime = packet->lastResendTime;
+            sample.bytes = packet->flightSize;
+            sample.bytesInFlight = bytesInFlight_;
+            sample.rtt = rtt;
+            sample.smoothedRtt = rtt_;
+            removeFromFlight(*packet);
+
+            // Delivery rate over the time this packet was in flight. Taking the
+            // longer of the send and ack intervals keeps a burst of acks the
+            // peer held back from reading as a burst of bandwidth.
+            delivered_ += sample.bytes;
+            deliveredTime_ = now;
+            firstSentTime_ = packet->lastResendTime;
+            float sendInterval = std::chrono::duration<float>(packet->lastResendTime - packet->firstSentTimeAtSend).count();
+            float ackInterval = std::chrono::duration<float>(now - packet->deliveredTimeAtSend).count();
+            float interval = std::max(sendInterval, ackInterval);
+            if (interval > 0.0f) {
+                sample.deliveryRate = static_cast<float>(delivered_ - packet->deliveredAtSend) / interval;
+            }
+            sample.delivered = delivered_;
+            sample.deliveredAtSend = packet->deliveredAtSend;
+            sample.appLimited = packet->appLimited;
+            if (appLimitedUntil_ != 0 && delivered_ > appLimitedUntil_) {
+                appLimitedUntil_ = 0;
+            }
+            if (congestion_) {
+                congestion_->onAck(sample);
+            }
+        }
     }
 }
 
-void Connection::resendUnacknowledgedPackets() {
-    auto now = std::chrono::steady_clock::now();
-    
-    for (auto it = unacknowledgedPackets_.begin(); it != unacknowledgedPackets_.end();) {
-        if (shouldResendPacket(it->second)) {
-            it->second.lastResendTime = now;
-            ++it;
-        } else {
-            it = unacknowledgedPackets_.erase(it);
+void Connection::detectLosses(std::chrono::steady_clock::time_point now) {
+    if (!hasLargestAcknowledged_) return;
+
+    // Judge each sequence once, when the largest ack gets far enough past it;
+    // anything before the send window is already acked or never needed it
+    if (sequenceLessThan(lossScanSequence_, oldestUnacknowledged_)) {
+        lossScanSequence_ = oldestUnacknowledged_;
+    }
+
+    uint16_t end = static_cast<uint16_t>(largestAcknowledged_ - FAST_RETRANSMIT_THRESHOLD + 1);
+    for (; sequenceLessThan(lossScanSequence_, end); ++lossScanSequence_) {
+        Packet* packet = sentPackets_.find(lossScanSequence_);
+        if (!packet || !isReliable(packet->reliability) || packet->isAcknowledged || packet->resendCount > 0) {
+            continue;
+        }
+
+        // Pull its timer forward so the next flush resends it
+        packet->resendDeadline = now;
+        resendTimers_.push({ now, lossScanSequence_ });
+        fastRetransmits_++;
+    }
+}
+
+void Connection::updateRoundTripTime(float sample) {
+    // RFC 6298: the variance is updated against the previous smoothed RTT
+    if (!hasRttSample_) {
+        rtt_ = sample;
+        rttVariance_ = sample / 2.0f;
+        hasRttSample_ = true;
+    } else {
+        rttVariance_ = (1.0f - RTT_BETA) * rttVariance_ + RTT_BETA * std::abs(rtt_ - sample);
+        rtt_ = (1.0f - RTT_ALPHA) * rtt_ + RTT_ALPHA * sample;
+    }
+    rto_ = std::min(std::max(rtt_ + 4.0f * rttVariance_, MIN_RTO), MAX_RTO);
+}
+
+std::chrono::steady_clock::duration Connection::getResendTimeout(const Packet& packet) const {
+    // Exponential backoff: each resend of the same packet doubles its timeout
+    float timeout = rto_ * static_cast<float>(1u << std::min(packet.resendCount, 16u));
+    return toDuration(std::min(timeout, MAX_RTO));
+}
+
+uint32_t Connection::getAckBits(uint16_t ack) const {
+    uint32_t ackBits = 0;
+    for (uint32_t i = 0; i < ACK_BITS; ++i) {
+        if (receivedWindow_.contains(static_cast<uint16_t>(ack - i - 1))) {
+            ackBits |= 1u << i;
         }
     }
+    return ackBits;
 }
 
-bool Connection::shouldResendPacket(const Packet& packet) const {
-    if (packet.isAcknowledged) {
+Packet Connection::makeAckPacket(uint16_t ack) const {
+    // Header only: an empty unreliable payload marks the packet as a bare ack
+    Packet packet;
+    packet.sequenceNumber = 0;
+    packet.timestamp = 0;
+    packet.reliability = PacketReliability::UNRELIABLE;
+    packet.data = bufferPool_->acquire();
+    packet.header.hasAck = true;
+    packet.header.ack = ack;
+    packet.header.ackBits = getAckBits(ack);
+    packet.isAcknowledged = false;
+    packet.resendCount = 0;
+    return packet;
+}
+
+void Connection::appendParityPackets(std::vector<Packet>& packets) {
+    for (uint8_t i = 0; i < fecEncoder_->getParityCount(); ++i) {
+        Packet packet;
+        packet.sequenceNumber = 0;
+        packet.timestamp = packets.back().timestamp;
+        packet.reliability = PacketReliability::UNRELIABLE;
+        packet.isAcknowledged = false;
+        packet.resendCount = 0;
+        fecEncoder_->takeParity(i, packet.header, packet.data);
+        packets.push_back(std::move(packet));
+    }
+}
+
+bool Connection::writeHeader(Packet& packet) const {
+    size_t headerSize = packet.header.getEncodedSize();
+    uint8_t* header = packet.data.prepend(headerSize);
+    if (!header) {
+        std::cerr << "No headroom for packet header" << std::endl;
         return false;
     }
+    return packet.header.encode(header, headerSize) == headerSize;
+}
 
-    auto now = std::chrono::steady_clock::now();
-    auto timeSinceLastResend = std::chrono::duration_cast<std::chrono::seconds>(
-        now - packet.lastResendTime).count();
+void Connection::coalescePackets(std::vector<Packet>& packets, std::vector<Packet>& datagrams) const {
+    // Pack each run of packets that fits in one datagram into a bundle; a
+    // run of one, a bare ack or a packet too big to share goes out alone. So
+    // does every member of a FEC group, since a lost bundle would take
+    // several symbols of the group with it.
+    size_t limit = std::min<size_t>(maxPacketSize_, UINT16_MAX);
+
+    size_t begin = 0;
+    while (begin < packets.size()) {
+        WireHeader bundleHeader;
+        bundleHeader.flags = WireHeader::BUNDLE;
+        bundleHeader.hasAck = packets[begin].header.hasAck;
+        size_t size = bundleHeader.getEncodedSize();
+
+        size_t end = begin;
+        while (end < packets.size() && !packets[end].data.empty() &&
+               !(packets[end].header.flags & WireHeader::FEC)) {
+            WireHeader entryHeader = packets[end].header;
+            entryHeader.hasAck = false;
+            size_t entrySize = WireHeader::BUNDLE_LENGTH_SIZE + entryHeader.getEncodedSize() + packets[end].data.size();
+            if (size + entrySize > limit || packets[end].header.hasAck != bundleHeader.hasAck) {
+                break;
+            }
+            size += entrySize;
+            ++end;
+        }
+
+        if (end - begin >= 2) {
+            datagrams.push_back(makeBundle(packets, begin, end, size));
+            begin = end;
+        } else {
+            writeHeader(packets[begin]);
+            datagrams.push_back(std::move(packets[begin]));
+            ++begin;
+        }
+    }
+}
+
+Packet Connection::makeBundle(std::vector<Packet>& packets, size_t begin, size_t end, size_t size) const {
+    // The acks of the first packet are current for the whole run
+    Packet bundle;
+    bundle.sequenceNumber = 0;
+    bundle.timestamp = packets[begin].timestamp;
+    bundle.reliability = PacketReliability::UNRELIABLE;
+    bundle.header.flags = WireHeader::BUNDLE;
+    bundle.header.hasAck = packets[begin].header.hasAck;
+    bundle.header.ack = packets[begin].header.ack;
+    bundle.header.ackBits = packets[begin].header.ackBits;
+    bundle.isAcknowledged = false;
+    bundle.resendCount = 0;
+    bundle.data = bufferPool_->acquire(size);
+
+    for (size_t i = begin; i < end; ++i) {
+        WireHeader entryHeader = packets[i].header;
+        entryHeader.hasAck = false;
+        size_t headerSize = entryHeader.getEncodedSize();
+        size_t entrySize = headerSize + packets[i].data.size();
+
+        uint8_t* entry = bundle.data.append(WireHeader::BUNDLE_LENGTH_SIZE + entrySize);
+        entry[0] = static_cast<uint8_t>(entrySize);
+        entry[1] = static_cast<uint8_t>(entrySize >> 8);
+        entryHeader.encode(entry + WireHeader::BUNDLE_LENGTH_SIZE, headerSize);
+        std::memcpy(entry + WireHeader::BUNDLE_LENGTH_SIZE + headerSize, packets[i].data.data(), packets[i].data.size());
+    }
+
+    writeHeader(bundle);
+    return bundle;
+}
+
+void Connection::advanceOldestUnacknowledged() {
+    while (oldestUnacknowledged_ != nextSequence_) {
+        const Packet* packet = sentPackets_.find(oldestUnacknowledged_);
+        if (packet && isReliable(packet->reliability) && !packet->isAcknowledged) {
+            break;
+        }
+        oldestUnacknowledged_++;
+    }
+}
+
+void Connection::failConnection() {
+    // Nothing queued or in flight will be sent again
+    connected_ = false;
+    outgoingPackets_.clear();
+    flushPackets_.clear();
+    explicitAcks_.clear();
+    resendTimers_ = decltype(resendTimers_)();
+    sentPackets_.reset();
+    bytesInFlight_ = 0;
+    ackPending_ = false;
+    keepAlivePending_ = false;
+    pacingBlocked_ = false;
+}
+
+void Connection::scheduleResend(Packet& packet, std::chrono::steady_clock::time_point now) {
+    packet.resendDeadline = now + getResendTimeout(packet);
+    resendTimers_.push({ packet.resendDeadline, static_cast<uint16_t>(packet.sequenceNumber) });
+}
+
+void Connection::addToFlight(Packet& packet, std::chrono::steady_clock::time_point now) {
+    // Idle time before the flight started says nothing about the path
+    if (bytesInFlight_ == 0) {
+        deliveredTime_ = now;
+        firstSentTime_ = now;
+    }
+    packet.flightSize = static_cast<uint32_t>(packet.data.size() + packet.header.getEncodedSize());
+    packet.deliveredAtSend = delivered_;
+    packet.deliveredTimeAtSend = deliveredTime_;
+    packet.firstSentTimeAtSend = firstSentTime_;
+    packet.appLimited = appLimitedUntil_ != 0;
+    bytesInFlight_ += packet.flightSize;
+}
+
+void Connection::removeFromFlight(Packet& packet) {
+    bytesInFlight_ -= std::min<size_t>(packet.flightSize, bytesInFlight_);
+    packet.flightSize = 0;
+}
+
+bool Connection::isCongestionLimited(const Packet& packet) const {
+    // An empty flight always admits one packet, however small the window
+    if (!congestion_ || bytesInFlight_ == 0) return false;
+    return bytesInFlight_ + packet.data.size() + packet.header.getEncodedSize() > congestion_->getCongestionWindow();
+}
+
+void Connection::refillPacingCredit(std::chrono::steady_clock::time_point now) {
+    float rate = congestion_ ? congestion_->getPacingRate() : 0.0f;
+    float elapsed = std::chrono::duration<float>(now - pacingUpdate_).count();
+    pacingUpdate_ = now;
+    if (rate <= 0.0f) return;
+
+    // Credit is capped at a short burst so an idle spell is not saved up
+    float burst = std::max(static_cast<float>(PACING_BURST_PACKETS * maxPacketSize_), rate * PACING_QUANTUM);
+    pacingCredit_ = std::min(pacingCredit_ + rate * elapsed, burst);
+}
 
-    return timeSinceLastResend >= RESEND_TIMEOUT;
+bool Connection::isResendTimerCurrent(const ResendTimer& timer) {
+    // The slot may since hold a newer sequence, or the packet a later deadline
+    const Packet* packet = sentPackets_.find(timer.sequence);
+    return packet && isReliable(packet->reliability) && !packet->isAcknowledged &&
+           packet->resendDeadline == timer.deadline;
 }
 
 void Connection::updateStatistics() {
@@ -144,4 +743,4 @@ void Connection::updateStatistics() {
     }
 }
 
-} // namespace BarrenEngine 
\ No newline at end of file
+} // namespace BarrenEngine
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
 
 namespace BarrenEngine {
 
@@ -81,6 +82,16 @@ std::vector<uint8_t> Crypto::generateIV() {
     return iv;
 }
 
+void Crypto::generateIV(uint8_t* iv) {
+    // Seeded once per thread; random_device is far too slow to open per packet
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> dis(0, 255);
+
+    for (size_t i = 0; i < IV_SIZE; ++i) {
+        iv[i] = static_cast<uint8_t>(dis(gen));
+    }
+}
+
 void Crypto::encryptBlock(std::array<uint8_t, BLOCK_SIZE>& block,
                         const std::array<uint8_t, BLOCK_SIZE>& key) {
     // Initial round key addition
@@ -207,6 +218,100 @@ std::vector<uint8_t> Crypto::decrypt(const std::vector<uint8_t>& encryptedData,
     }
 }
 
+size_t Crypto::encrypt(uint8_t* data, size_t size, size_t capacity,
+                      const std::vector<uint8_t>& key,
+                      const uint8_t* iv,
+                      Mode mode) {
+    if (!validateKey(key) || !iv) {
+        throw std::invalid_argument("Invalid key or IV");
+    }
+
+    size_t paddingSize = BLOCK_SIZE - (size % BLOCK_SIZE);
+    size_t paddedSize = size + paddingSize;
+    size_t totalSize = paddedSize + (mode == Mode::GCM ? GCM_TAG_SIZE : 0);
+    if (totalSize > capacity) {
+        throw std::length_error("Insufficient room for encryption padding");
+    }
+
+    // Same layout as the vector path: PKCS#7 padding, then the tag for GCM
+    std::memset(data + size, static_cast<int>(paddingSize), paddingSize);
+
+    std::array<uint8_t, BLOCK_SIZE> keyArray;
+    std::copy(key.begin(), key.begin() + BLOCK_SIZE, keyArray.begin());
+
+    std::array<uint8_t, BLOCK_SIZE> previousBlock{};
+    std::copy(iv, iv + IV_SIZE, previousBlock.begin());
+
+    for (size_t i = 0; i < paddedSize; i += BLOCK_SIZE) {
+        std::array<uint8_t, BLOCK_SIZE> block;
+        std::copy(data + i, data + i + BLOCK_SIZE, block.begin());
+
+        if (mode != Mode::ECB) {
+            xorBlocks(block, previousBlock);
+        }
+        encryptBlock(block, keyArray);
+        previousBlock = block;
+
+        std::copy(block.begin(), block.end(), data + i);
+    }
+
+    if (mode == Mode::GCM) {
+        // ... (GCM authentication implementation)
+        std::memset(data + paddedSize, 0, GCM_TAG_SIZE);
+    }
+
+    return totalSize;
+}
+
+size_t Crypto::decrypt(uint8_t* data, size_t size,
+                      const std::vector<uint8_t>& key,
+                      const uint8_t* iv,
+                      Mode mode) {
+    if (!validateKey(key) || !iv) {
+        throw std::invalid_argument("Invalid key or IV");
+    }
+
+    if (mode == Mode::GCM) {
+        if (size < GCM_TAG_SIZE) {
+            throw std::invalid_argument("Invalid data size for GCM decryption");
+        }
+        // ... (GCM authentication verification)
+        size -= GCM_TAG_SIZE;
+    }
+
+    if (size == 0 || size % BLOCK_SIZE != 0) {
+        throw std::invalid_argument("Invalid data size for decryption");
+    }
+
+    std::array<uint8_t, BLOCK_SIZE> keyArray;
+    std::copy(key.begin(), key.begin() + BLOCK_SIZE, keyArray.begin());
+
+    std::array<uint8_t, BLOCK_SIZE> previousBlock{};
+    std::copy(iv, iv + IV_SIZE, previousBlock.begin());
+
+    for (size_t i = 0; i < size; i += BLOCK_SIZE) {
+        std::array<uint8_t, BLOCK_SIZE> block;
+        std::copy(data + i, data + i + BLOCK_SIZE, block.begin());
+
+        // The ciphertext is overwritten below, so keep it for the next block
+        std::array<uint8_t, BLOCK_SIZE> currentBlock = block;
+        decryptBlock(block, keyArray);
+        if (mode != Mode::ECB) {
+            xorBlocks(block, previousBlock);
+        }
+        previousBlock = currentBlock;
+
+        std::copy(block.begin(), block.end(), data + i);
+    }
+
+    uint8_t paddingSize = data[size - 1];
+    if (paddingSize > BLOCK_SIZE || paddingSize == 0) {
+        throw std::runtime_error("Invalid padding");
+    }
+
+    return size - paddingSize;
+}
+
 bool Crypto::validateKey(const std::vector<uint8_t>& key) {
     return key.size() == KEY_SIZE_128 / 8 || key.size() == KEY_SIZE_256 / 8;
 }
@@ -318,7 +423,7 @@ std::vector<uint8_t> Crypto::encryptCBC(const std::vector<uint8_t>& data,
     std::array<uint8_t, BLOCK_SIZE> keyArray;
     std::copy(key.begin(), key.begin() + BLOCK_SIZE, keyArray.begin());
     
-    std::array<uint8_t, BLOCK_SIZE> previousBlock;
+    std::array<uint8_t, BLOCK_SIZE> previousBlock{};
     std::copy(iv.begin(), iv.end(), previousBlock.begin());
     
     for (size_t i = 0; i < paddedData.size(); i += BLOCK_SIZE) {
@@ -353,7 +458,7 @@ std::vector<uint8_t> Crypto::decryptCBC(const std::vector<uint8_t>& data,
     std::array<uint8_t, BLOCK_SIZE> keyArray;
     std::copy(key.begin(), key.begin() + BLOCK_SIZE, keyArray.begin());
     
-    std::array<uint8_t, BLOCK_SIZE> previousBlock;
+    std::array<uint8_t, BLOCK_SIZE> previousBlock{};
     std::copy(iv.begin(), iv.end(), previousBlock.begin());
     
     for (size_t i = 0; i < data.size(); i += BLOCK_SIZE) {
@@ -5,16 +5,31 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 namespace BarrenEngine {
 
+namespace {
+
+// Fills a vector-owning message from a view, every field included
+void copyMessage(const NetworkMessageView& view, NetworkMessage& message) {
+    message.data.assign(view.data(), view.data() + view.size());
+    message.timestamp = view.timestamp;
+    message.reliability = view.reliability;
+    message.messageId = view.messageId;
+    message.fragmentIndex = view.fragmentIndex;
+    message.totalFragments = view.totalFragments;
+    message.isFragment = view.isFragment;
+    message.clientId = view.clientId;
+    message.channel = view.channel;
+}
+
+} // namespace
+
 NetworkManager::NetworkManager()
     : running_(false)
-    , socket_(-1)
-    , bytesSent_(0)
-    , bytesReceived_(0)
-    , averageLatency_(0.0f)
-    , packetLoss_(0.0f)
+    , isServer_(false)
+    , droppedMessages_(0)
     , nextMessageId_(0)
     , packetValidationEnabled_(false)
     , packetLoggingEnabled_(false)
@@ -32,6 +47,25 @@ bool NetworkManager::initialize(const NetworkConfig& config) {
     packetValidationEnabled_ = config.enablePacketValidation;
     packetLoggingEnabled_ = config.enablePacketLogging;
 
+    // A full fragment must leave as one datagram that fits a receive slot and,
+    // with io_uring, a registered send slot
+    if (config.fragmentSize > 0) {
+        size_t datagramSize = WireHeader::MAX_SIZE + config.fragmentSize;
+        if (config.enableEncryption) {
+            datagramSize += Crypto::IV_SIZE + Crypto::getOverhead(config.encryptionMode);
+        }
+        if (datagramSize > config.bufferSize) {
+            std::cerr << "Fragments of " << config.fragmentSize << " bytes take up to " << datagramSize
+                      << " bytes on the wire, more than the " << config.bufferSize << " byte buffers" << std::endl;
+            return false;
+        }
+    }
+
+    // Every outgoing fragment, with its header, IV and padding, fits one pooled block
+    bufferPool_ = std::make_unique<BufferPool>(std::max(config.bufferSize, config.fragmentSize));
+    messageQueue_ = std::make_unique<MessageRing<NetworkMessageView>>(
+        config.inboundQueueSize > 0 ? config.inboundQueueSize : DEFAULT_INBOUND_QUEUE_SIZE);
+
     if (packetLoggingEnabled_) {
         packetLog_.open("network_packets.log", std::ios::app);
         if (!packetLog_.is_open()) {
@@ -40,324 +74,782 @@ bool NetworkManager::initialize(const NetworkConfig& config) {
         }
     }
 
-    return setupSocket();
+    return true;
 }
 
 void NetworkManager::shutdown() {
-    running_ = false;
-    if (networkThread_.joinable()) {
-        networkThread_.join();
-    }
+    stopWorkers();
     cleanupSocket();
-    
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    connections_.clear();
 }
 
-bool NetworkManager::setupSocket() {
-    // Remove all remaining references to send(socket_, ...), setupSocket(), INVALID_SOCKET, and any other socket API calls. Replace with stubs or comments for your custom socket layer.
+bool NetworkManager::setupSockets(uint32_t shardCount, uint16_t port) {
+    cleanupSocket();
+    shardCount = std::min(std::max(shardCount, 1u), MAX_SHARDS);
+
+    for (uint32_t i = 0; i < shardCount; ++i) {
+        auto shard = std::make_unique<Shard>(i, *bufferPool_, config_);
+        if (!setupSocket(*shard, shardCount > 1, port)) {
+            cleanupSocket();
+            return false;
+        }
+        shards_.push_back(std::move(shard));
+    }
     return true;
 }
 
+bool NetworkManager::setupSocket(Shard& shard, bool reusePort, uint16_t port) {
+    if (!shard.socket.open(config_.bufferSize, reusePort)) return false;
+    if (port != 0 && !shard.socket.bind(port)) return false;
+
+    if (config_.transport == TransportBackend::IO_URING &&
+        !shard.uring.open(shard.socket.getHandle(), config_.bufferSize)) {
+        std::cerr << "io_uring backend unavailable, using socket backend" << std::endl;
+    }
+
+    // io_uring buffers are sized for single datagrams, so GRO stays off there
+    if (config_.enableSegmentationOffload && !shard.uring.isOpen()) {
+        shard.socket.enableSegmentationOffload();
+    }
+
+    // With io_uring the ring descriptor signals both receives and send completions
+    int handle = shard.uring.isOpen() ? shard.uring.getHandle() : shard.socket.getHandle();
+    return shard.reactor.open(handle);
+}
+
 void NetworkManager::cleanupSocket() {
-    // Remove all remaining references to send(socket_, ...), setupSocket(), INVALID_SOCKET, and any other socket API calls. Replace with stubs or comments for your custom socket layer.
+    for (auto& shard : shards_) {
+        shard->reactor.close();
+        shard->uring.close();
+        shard->socket.close();
+    }
+    shards_.clear();
 }
 
-bool NetworkManager::startServer() {
-    // Server start logic removed (using custom socket layer)
+void NetworkManager::startWorkers() {
     running_ = true;
-    networkThread_ = std::thread(&NetworkManager::networkLoop, this);
+    for (auto& shard : shards_) {
+        shard->thread = std::thread(&NetworkManager::networkLoop, this, std::ref(*shard));
+    }
+}
+
+void NetworkManager::stopWorkers() {
+    running_ = false;
+    for (auto& shard : shards_) {
+        shard->reactor.wakeup();
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+NetworkManager::Shard* NetworkManager::findShard(uint32_t clientId) const {
+    uint32_t index = clientId >> SHARD_SHIFT;
+    return index < shards_.size() ? shards_[index].get() : nullptr;
+}
+
+bool NetworkManager::startServer() {
+    if (running_) return false;
+    if (!setupSockets(config_.workerThreads, config_.port)) {
+        return false;
+    }
+
+    isServer_ = true;
+    startWorkers();
     return true;
 }
 
 bool NetworkManager::connect(const std::string& address, uint16_t port) {
-    // Connect logic removed (using custom socket layer)
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    connections_[0] = std::make_unique<Connection>(config_.bufferSize);
-    running_ = true;
-    networkThread_ = std::thread(&NetworkManager::networkLoop, this);
+    if (running_) return false;
+
+    Endpoint server;
+    if (!UdpSocket::resolve(address, port, server) || !setupSockets(1, 0)) {
+        return false;
+    }
+
+    {
+        // Client mode: a single shard where the server is always connection 0
+        Shard& shard = *shards_[0];
+        std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+        auto connection = std::make_unique<Connection>(getDatagramLimit(), bufferPool_.get());
+        connection->setConnected(true);
+        connection->enableFec(config_.fecDataPackets, config_.fecParityPackets);
+        connection->setCongestionControl(config_.congestionControl);
+        shard.connections[0] = std::move(connection);
+        shard.clientIds[server] = 0;
+        shard.clientEndpoints[0] = server;
+        // Times out like any other connection if the server never answers
+        shard.lastActivity[0] = std::chrono::steady_clock::now();
+    }
+
+    isServer_ = false;
+    startWorkers();
     return true;
 }
 
 void NetworkManager::disconnect() {
-    running_ = false;
-    if (networkThread_.joinable()) {
-        networkThread_.join();
-    }
+    stopWorkers();
     cleanupSocket();
 }
 
 int NetworkManager::send(const NetworkMessage& message) {
-    if (!running_) return -1;
-
-    // Generate message ID if not set
-    NetworkMessage msg = message;
-    if (msg.messageId == 0) {
-        msg.messageId = ++nextMessageId_;
-    }
-
-    // Fragment large messages
-    if (msg.data.size() > config_.fragmentSize) {
-        auto fragments = fragmentMessage(msg);
-        int totalSent = 0;
-        for (const auto& fragment : fragments) {
-            int sent = send(fragment);
-            if (sent < 0) return sent;
-            totalSent += sent;
+    if (!running_ || message.data.empty() || message.channel >= Connection::MAX_CHANNELS) return -1;
+
+    // Queue on the destination connection; its shard thread flushes it
+    Shard* shard = findShard(message.clientId);
+    if (!shard) return -1;
+
+    // Slice large messages into fragments straight from the caller's bytes;
+    // each slice is copied once into a pooled buffer and processed in place
+    size_t size = message.data.size();
+    size_t fragmentSize = config_.fragmentSize > 0 ? config_.fragmentSize : size;
+    int bytesQueued = 0;
+
+    WireHeader header;
+    header.totalFragments = static_cast<uint32_t>((size + fragmentSize - 1) / fragmentSize);
+    header.isFragment = header.totalFragments > 1;
+    header.messageId = message.messageId != 0 ? message.messageId : ++nextMessageId_;
+
+    for (size_t offset = 0; offset < size; offset += fragmentSize) {
+        size_t length = std::min(fragmentSize, size - offset);
+        PacketBuffer buffer = bufferPool_->acquire(length);
+        buffer.append(message.data.data() + offset, length);
+
+        header.fragmentIndex = static_cast<uint32_t>(offset / fragmentSize);
+        header.flags = 0;
+        if (!processOutgoingData(buffer, header)) return -1;
+
+        // Log outgoing packet
+        if (packetLoggingEnabled_) {
+            logPacket(buffer.data(), buffer.size(), true);
         }
-        return totalSent;
-    }
 
-    // Process and send the message
-    std::vector<uint8_t> processedData = processOutgoingData(msg.data);
-    if (processedData.empty()) return -1;
-
-    // Log outgoing packet
-    if (packetLoggingEnabled_) {
-        logPacket(processedData, true);
-    }
+        // Validate packet if enabled
+        if (packetValidationEnabled_) {
+            validatePacket(buffer.data(), buffer.size());
+        }
 
-    // Validate packet if enabled
-    if (packetValidationEnabled_) {
-        validatePacket(processedData);
+        bytesQueued += static_cast<int>(buffer.size());
+        {
+            std::lock_guard<std::mutex> lock(shard->connectionsMutex);
+            auto it = shard->connections.find(message.clientId);
+            if (it == shard->connections.end()) return -1;
+            it->second->queuePacket(std::move(buffer), message.reliability, message.channel, header);
+        }
     }
 
-    // Send the packet
-    int bytesSent = 0;
-    // [Custom socket send logic should go here]
-    bytesSent = static_cast<int>(processedData.size());
-    if (bytesSent > 0) {
-        bytesSent_ += bytesSent;
-    }
-    return bytesSent;
+    shard->reactor.wakeup();
+    return bytesQueued;
 }
 
 bool NetworkManager::receive(NetworkMessage& message) {
-    std::lock_guard<std::mutex> lock(messageQueueMutex_);
-    if (messageQueue_.empty()) return false;
+    NetworkMessageView view;
+    if (!receive(view)) return false;
 
-    message = messageQueue_.front();
-    messageQueue_.pop();
+    copyMessage(view, message);
     return true;
 }
 
+bool NetworkManager::receive(NetworkMessageView& message) {
+    return messageQueue_ && messageQueue_->tryPop(message);
+}
+
+size_t NetworkManager::receiveBatch(NetworkMessage* messages, size_t count) {
+    // Copies into the callers' vectors, which keep their capacity between frames
+    size_t received = 0;
+    while (received < count && receive(messages[received])) {
+        ++received;
+    }
+    return received;
+}
+
+size_t NetworkManager::receiveBatch(NetworkMessageView* messages, size_t count) {
+    return messageQueue_ ? messageQueue_->popBatch(messages, count) : 0;
+}
+
 void NetworkManager::setMessageCallback(std::function<void(const NetworkMessage&)> callback) {
     messageCallback_ = callback;
 }
 
+void NetworkManager::setMessageViewCallback(std::function<void(const NetworkMessageView&)> callback) {
+    messageViewCallback_ = callback;
+}
+
+void NetworkManager::setDisconnectCallback(std::function<void(uint32_t)> callback) {
+    disconnectCallback_ = callback;
+}
+
 void NetworkManager::disconnectClient(uint32_t clientId) {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    connections_.erase(clientId);
+    Shard* shard = findShard(clientId);
+    if (!shard) return;
+
+    std::lock_guard<std::mutex> lock(shard->connectionsMutex);
+    shard->connections.erase(clientId);
+
+    auto it = shard->clientEndpoints.find(clientId);
+    if (it != shard->clientEndpoints.end()) {
+        shard->clientIds.erase(it->second);
+        shard->clientEndpoints.erase(it);
+    }
 }
 
 bool NetworkManager::isClientConnected(uint32_t clientId) const {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
-    return connections_.find(clientId) != connections_.end();
+    Shard* shard = findShard(clientId);
+    if (!shard) return false;
+
+    std::lock_guard<std::mutex> lock(shard->connectionsMutex);
+    return shard->connections.find(clientId) != shard->connections.end();
 }
 
 std::vector<uint32_t> NetworkManager::getConnectedClients() const {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
     std::vector<uint32_t> clients;
-    clients.reserve(connections_.size());
-    for (const auto& pair : connections_) {
-        clients.push_back(pair.first);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->connectionsMutex);
+        for (const auto& pair : shard->connections) {
+            clients.push_back(pair.first);
+        }
     }
     return clients;
 }
 
 float NetworkManager::getAverageLatency() const {
-    return averageLatency_;
+    if (shards_.empty()) return 0.0f;
+
+    float total = 0.0f;
+    for (const auto& shard : shards_) {
+        total += shard->averageLatency;
+    }
+    return total / shards_.size();
 }
 
 float NetworkManager::getPacketLoss() const {
-    return packetLoss_;
+    if (shards_.empty()) return 0.0f;
+
+    float total = 0.0f;
+    for (const auto& shard : shards_) {
+        total += shard->packetLoss;
+    }
+    return total / shards_.size();
 }
 
 size_t NetworkManager::getBytesSent() const {
-    return bytesSent_;
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->bytesSent;
+    }
+    return total;
+}
+
+size_t NetworkManager::getDroppedMessages() const {
+    return droppedMessages_;
+}
+
+size_t NetworkManager::getDroppedDatagrams() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->uring.getDroppedDatagrams();
+    }
+    return total;
 }
 
 size_t NetworkManager::getBytesReceived() const {
-    return bytesReceived_;
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->bytesReceived;
+    }
+    return total;
 }
 
-void NetworkManager::networkLoop() {
-    std::vector<uint8_t> buffer(config_.bufferSize);
-    
+void NetworkManager::networkLoop(Shard& shard) {
+    // Plain sockets receive straight into pooled blocks that are then handed
+    // on as messages. GRO slots must fit a whole coalesced burst, so they use
+    // one contiguous area and copy each segment out; io_uring brings its own.
+    bool directReceive = !shard.uring.isOpen() && !shard.socket.isReceiveOffloadEnabled();
+    uint32_t slotSize = shard.socket.isReceiveOffloadEnabled()
+        ? static_cast<uint32_t>(UdpSocket::MAX_GRO_DATAGRAM) : config_.bufferSize;
+    std::vector<uint8_t> buffer(directReceive ? 0 : static_cast<size_t>(slotSize) * UdpSocket::MAX_BATCH);
+    std::vector<Datagram> receiveSlots(UdpSocket::MAX_BATCH);
+    std::vector<PacketBuffer> slotBuffers(directReceive ? UdpSocket::MAX_BATCH : 0);
+    for (size_t i = 0; i < receiveSlots.size() && !directReceive; ++i) {
+        receiveSlots[i].data = buffer.data() + i * slotSize;
+        receiveSlots[i].capacity = slotSize;
+    }
+    std::vector<Packet> outgoingPackets;
+    std::vector<Datagram> outgoingDatagrams;
+
+    shard.lastKeepAlive = std::chrono::steady_clock::now();
+    shard.nextTimeoutCheck = shard.lastKeepAlive;
+
+    // Prime the receive path; io_uring arms its multishot receive here. The
+    // first keep-alive is due even if nothing wakes the shard before it.
+    receivePackets(shard, receiveSlots, slotBuffers);
+    shard.reactor.setDeadline(getNextDeadline(shard));
+
     while (running_) {
-        // [Custom socket receive logic should go here]
-        // Process outgoing messages
-        {
-            std::lock_guard<std::mutex> lock(connectionsMutex_);
-            for (auto& pair : connections_) {
-                auto& connection = pair.second;
-                connection->update(0.016f); // Assume 60 FPS update rate
-                auto packets = connection->getPacketsToSend();
-                for (const auto& packet : packets) {
-                    // [Custom socket send logic should go here]
-                    bytesSent_ += packet.data.size();
-                }
-            }
+        // Sleep until the socket, a send() call or the next deadline needs us
+        uint32_t events = shard.reactor.wait();
+        if (!running_) break;
+
+        if (events & Reactor::SOCKET_READABLE) {
+            receivePackets(shard, receiveSlots, slotBuffers);
+        }
+        if (events & Reactor::TIMER) {
+            handleKeepAlive(shard);
+            checkConnectionTimeouts(shard);
+            shard.fragments.expire(std::chrono::steady_clock::now());
         }
+        flushOutgoingPackets(shard, outgoingPackets, outgoingDatagrams);
+
         // Update statistics
-        updateStatistics();
-        // Small sleep to prevent CPU spinning
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        updateStatistics(shard);
+        shard.reactor.setDeadline(getNextDeadline(shard));
+    }
+}
+
+std::chrono::steady_clock::time_point NetworkManager::getNextDeadline(Shard& shard) {
+    auto next = std::chrono::steady_clock::time_point::max();
+    if (config_.keepAliveInterval > 0) {
+        next = shard.lastKeepAlive + std::chrono::milliseconds(config_.keepAliveInterval);
+    }
+    if (config_.connectionTimeout > 0) {
+        next = std::min(next, shard.nextTimeoutCheck);
+    }
+    next = std::min(next, shard.fragments.getNextExpiry());
+
+    std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+    for (auto& pair : shard.connections) {
+        next = std::min(next, pair.second->getNextSendTime());
     }
+    return next;
 }
 
-void NetworkManager::processIncomingData(const std::vector<uint8_t>& data, uint32_t clientId) {
-    if (data.empty()) return;
+void NetworkManager::receivePackets(Shard& shard, std::vector<Datagram>& slots, std::vector<PacketBuffer>& slotBuffers) {
+    // Drain the socket; a short batch means the kernel queue is empty
+    for (;;) {
+        // Refill the slots whose blocks were handed off by the previous batch
+        for (size_t i = 0; i < slotBuffers.size(); ++i) {
+            if (!slotBuffers[i]) {
+                slotBuffers[i] = bufferPool_->acquire(config_.bufferSize);
+                slots[i].capacity = static_cast<uint32_t>(slotBuffers[i].tailroom());
+                slots[i].data = slotBuffers[i].append(slots[i].capacity);
+            }
+        }
+
+        int received = receiveDatagrams(shard, slots.data(), slots.size());
+        if (received <= 0) break;
+
+        for (int i = 0; i < received; ++i) {
+            const Datagram& datagram = slots[i];
+            shard.bytesReceived += datagram.size;
+
+            uint32_t clientId = findOrAcceptClient(shard, datagram.endpoint);
+            if (clientId == INVALID_CLIENT_ID) continue;
+
+            if (!slotBuffers.empty()) {
+                PacketBuffer packet = std::move(slotBuffers[i]);
+                packet.resize(datagram.size);
+                processIncomingData(shard, std::move(packet), clientId);
+                continue;
+            }
+
+            // Split GRO-coalesced bursts back into the datagrams the peer sent
+            uint32_t segmentSize = datagram.segmentSize ? datagram.segmentSize : datagram.size;
+            for (uint32_t offset = 0; offset < datagram.size; offset += segmentSize) {
+                uint32_t length = std::min(segmentSize, datagram.size - offset);
+                PacketBuffer packet = bufferPool_->acquire(length);
+                packet.append(datagram.data + offset, length);
+                processIncomingData(shard, std::move(packet), clientId);
+            }
+        }
+
+        if (static_cast<size_t>(received) < slots.size()) break;
+    }
+}
+
+void NetworkManager::flushOutgoingPackets(Shard& shard, std::vector<Packet>& packets, std::vector<Datagram>& datagrams) {
+    packets.clear();
+    datagrams.clear();
+    std::vector<uint32_t> failed;
+
+    {
+        std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+        for (auto& pair : shard.connections) {
+            auto& connection = pair.second;
+            connection->update(0.016f); // Assume 60 FPS update rate
+
+            // Packets are moved straight into the shard's reused vector
+            auto endpoint = shard.clientEndpoints.find(pair.first);
+            size_t first = packets.size();
+            connection->getPacketsToSend(packets);
+            if (!connection->isConnected()) {
+                failed.push_back(pair.first);
+            }
+            if (endpoint == shard.clientEndpoints.end()) {
+                packets.resize(first);
+                continue;
+            }
+
+            Datagram datagram{};
+            datagram.endpoint = endpoint->second;
+            datagrams.resize(packets.size(), datagram);
+        }
+    }
+
+    // The resends ran out; closing takes the lock again
+    for (uint32_t clientId : failed) {
+        closeConnection(shard, clientId);
+    }
+
+    if (datagrams.empty()) return;
+
+    // Point the datagrams at the payloads only once the packet vector stops growing
+    for (size_t i = 0; i < datagrams.size(); ++i) {
+        datagrams[i].data = packets[i].data.data();
+        datagrams[i].size = static_cast<uint32_t>(packets[i].data.size());
+    }
+
+    int sent = sendDatagrams(shard, datagrams.data(), datagrams.size());
+    for (int i = 0; i < sent; ++i) {
+        shard.bytesSent += datagrams[i].size;
+    }
+}
+
+int NetworkManager::receiveDatagrams(Shard& shard, Datagram* datagrams, size_t count) {
+    return shard.uring.isOpen() ? shard.uring.receiveBatch(datagrams, count)
+                                : shard.socket.receiveBatch(datagrams, count);
+}
+
+int NetworkManager::sendDatagrams(Shard& shard, const Datagram* datagrams, size_t count) {
+    if (!shard.uring.isOpen()) {
+        return shard.socket.sendBatch(datagrams, count);
+    }
+
+    // Whatever does not fit the free send slots goes out through sendmmsg on
+    // the same socket instead of waiting for completions
+    int queued = std::max(shard.uring.sendBatch(datagrams, count), 0);
+    if (static_cast<size_t>(queued) == count) return queued;
+    int sent = shard.socket.sendBatch(datagrams + queued, count - queued);
+    return sent > 0 ? queued + sent : (queued > 0 ? queued : sent);
+}
+
+uint32_t NetworkManager::getDatagramLimit() const {
+    // Connections pack bundles up to the configured packet size, but never past what a receive slot holds
+    return config_.maxPacketSize > 0 ? std::min(config_.maxPacketSize, config_.bufferSize) : config_.bufferSize;
+}
+
+uint32_t NetworkManager::findOrAcceptClient(Shard& shard, const Endpoint& endpoint) {
+    std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+
+    auto it = shard.clientIds.find(endpoint);
+    if (it != shard.clientIds.end()) {
+        return it->second;
+    }
+
+    // Only servers accept datagrams from unknown peers; the connection limit is split across shards
+    size_t shardLimit = (config_.maxConnections + shards_.size() - 1) / shards_.size();
+    if (!isServer_ || shard.connections.size() >= shardLimit ||
+        shard.nextLocalId >= (1u << SHARD_SHIFT)) {
+        return INVALID_CLIENT_ID;
+    }
+
+    uint32_t clientId = (shard.index << SHARD_SHIFT) | shard.nextLocalId++;
+    auto connection = std::make_unique<Connection>(getDatagramLimit(), bufferPool_.get());
+    connection->setConnected(true);
+    connection->enableFec(config_.fecDataPackets, config_.fecParityPackets);
+    connection->setCongestionControl(config_.congestionControl);
+    shard.connections[clientId] = std::move(connection);
+    shard.clientIds[endpoint] = clientId;
+    shard.clientEndpoints[clientId] = endpoint;
+    shard.lastActivity[clientId] = std::chrono::steady_clock::now();
+    return clientId;
+}
+
+void NetworkManager::processIncomingData(Shard& shard, PacketBuffer packet, uint32_t clientId) {
+    if (packet.empty()) return;
 
     // Log incoming packet
     if (packetLoggingEnabled_) {
-        logPacket(data, false);
+        logPacket(packet.data(), packet.size(), false);
     }
 
     // Validate packet if enabled
     if (packetValidationEnabled_) {
-        validatePacket(data);
+        validatePacket(packet.data(), packet.size());
     }
 
-    // Process the data
-    std::vector<uint8_t> processedData = data;
-    if (config_.enableEncryption) {
-        // Extract IV from the beginning of the data
-        if (data.size() < Crypto::IV_SIZE) {
-            std::cerr << "Invalid encrypted data size" << std::endl;
+    // The wire header leads the datagram in the clear
+    WireHeader header;
+    size_t headerSize = header.decode(packet.data(), packet.size());
+    if (headerSize == 0) {
+        std::cerr << "Invalid packet header" << std::endl;
+        return;
+    }
+    packet.consume(headerSize);
+
+    if (header.flags & WireHeader::BUNDLE) {
+        processBundle(shard, header, std::move(packet), clientId);
+    } else {
+        processPacket(shard, header, std::move(packet), clientId);
+    }
+}
+
+void NetworkManager::processBundle(Shard& shard, const WireHeader& header, PacketBuffer bundle, uint32_t clientId) {
+    // Acks ride on the bundle itself
+    acceptPacket(shard, clientId, header, PacketBuffer());
+
+    // Each entry is handed on as a window into the same block. The windows
+    // never overlap, so every entry is still decrypted in place.
+    while (!bundle.empty()) {
+        const uint8_t* data = bundle.data();
+        size_t length = bundle.size() >= WireHeader::BUNDLE_LENGTH_SIZE ? (data[0] | (data[1] << 8)) : 0;
+        if (length == 0 || WireHeader::BUNDLE_LENGTH_SIZE + length > bundle.size()) {
+            std::cerr << "Invalid bundle entry" << std::endl;
+            return;
+        }
+        bundle.consume(WireHeader::BUNDLE_LENGTH_SIZE);
+
+        PacketBuffer entry = bundle;
+        entry.resize(length);
+        bundle.consume(length);
+
+        WireHeader entryHeader;
+        size_t headerSize = entryHeader.decode(entry.data(), entry.size());
+        if (headerSize == 0 || entryHeader.hasAck || (entryHeader.flags & WireHeader::BUNDLE)) {
+            std::cerr << "Invalid bundle entry" << std::endl;
+            return;
+        }
+        entry.consume(headerSize);
+        processPacket(shard, entryHeader, std::move(entry), clientId);
+    }
+}
+
+void NetworkManager::processPacket(Shard& shard, const WireHeader& header, PacketBuffer packet, uint32_t clientId,
+                                   bool recovered) {
+    // Drop resends we already have before spending any work on them; their
+    // acks and the ack they call for are still taken care of
+    bool duplicate = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+        auto it = shard.connections.find(clientId);
+        duplicate = it != shard.connections.end() && it->second->isDuplicate(header);
+    }
+    if (duplicate) {
+        acceptPacket(shard, clientId, header, PacketBuffer());
+        return;
+    }
+
+    // FEC works on the packets as sent, so rebuild lost ones before this one
+    // is decrypted. A parity packet has nothing else to deliver.
+    if (header.flags & WireHeader::FEC) {
+        recoverPackets(shard, header, packet, clientId);
+        if (header.fecIndex >= header.fecDataCount) {
+            acceptPacket(shard, clientId, header, PacketBuffer());
             return;
         }
+    }
+
+    // A bare ack carries nothing past the header
+    if (packet.empty() && !header.hasSequence() && !header.isFragment && header.flags == 0) {
+        acceptPacket(shard, clientId, header, PacketBuffer());
+        return;
+    }
+
+    // Never accept plaintext on an encrypted link, or ciphertext we cannot read
+    bool encrypted = (header.flags & WireHeader::ENCRYPTED) != 0;
+    if (encrypted != config_.enableEncryption) {
+        std::cerr << "Packet encryption does not match the connection" << std::endl;
+        return;
+    }
 
-        std::vector<uint8_t> iv(data.begin(), data.begin() + Crypto::IV_SIZE);
-        std::vector<uint8_t> encryptedData(data.begin() + Crypto::IV_SIZE, data.end());
+    // Process the data in place inside its pooled buffer
+    if (encrypted) {
+        // The IV leads the data and is dropped from the window once used
+        if (packet.size() < Crypto::IV_SIZE) {
+            std::cerr << "Invalid encrypted data size" << std::endl;
+            return;
+        }
 
         try {
-            processedData = Crypto::decrypt(encryptedData, config_.encryptionKey, iv, config_.encryptionMode);
+            size_t decryptedSize = Crypto::decrypt(packet.data() + Crypto::IV_SIZE, packet.size() - Crypto::IV_SIZE,
+                                                   config_.encryptionKey, packet.data(), config_.encryptionMode);
+            packet.consume(Crypto::IV_SIZE);
+            packet.resize(decryptedSize);
         } catch (const std::exception& e) {
             std::cerr << "Decryption failed: " << e.what() << std::endl;
             return;
         }
     }
 
-    if (config_.enableCompression) {
-        try {
-            processedData = Compression::decompress(processedData, config_.compressionAlgorithm);
-        } catch (const std::exception& e) {
-            std::cerr << "Decompression failed: " << e.what() << std::endl;
+    if (header.flags & WireHeader::COMPRESSED) {
+        // A single fragment never decompresses beyond a pooled block
+        size_t originalSize = Compression::getDecompressedSize(packet.data(), packet.size(), config_.compressionAlgorithm);
+        if (originalSize == 0 || originalSize > bufferPool_->getBlockCapacity()) {
+            std::cerr << "Invalid compressed data size" << std::endl;
             return;
         }
+
+        PacketBuffer decompressed = bufferPool_->acquire(originalSize);
+        uint8_t* output = decompressed.append(originalSize);
+        size_t decompressedSize = Compression::decompress(packet.data(), packet.size(), output,
+                                                          originalSize, config_.compressionAlgorithm);
+        if (decompressedSize == 0) {
+            std::cerr << "Decompression failed" << std::endl;
+            return;
+        }
+        decompressed.resize(decompressedSize);
+        packet = std::move(decompressed);
     }
 
-    // Create message from processed data
-    NetworkMessage message;
-    message.data = processedData;
-    message.timestamp = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count());
+    // Apply the peer's acks and drop resends we already delivered. The packet's
+    // channel may hold it back or release it together with packets it was
+    // blocking, in order.
+    acceptPacket(shard, clientId, header, std::move(packet), recovered);
+    for (auto& released : shard.releasedPackets) {
+        deliverPacket(shard, released.header, std::move(released.data), clientId);
+    }
+    shard.releasedPackets.clear();
+}
 
-    // Handle fragments
-    if (message.isFragment) {
-        std::lock_guard<std::mutex> lock(fragmentMutex_);
-        auto& fragmentInfo = fragmentMap_[message.messageId];
-        
-        if (fragmentInfo.fragments.empty()) {
-            fragmentInfo.timestamp = std::chrono::steady_clock::now();
-            fragmentInfo.totalFragments = message.totalFragments;
-            fragmentInfo.receivedFragments = 0;
+void NetworkManager::recoverPackets(Shard& shard, const WireHeader& header, const PacketBuffer& packet,
+                                    uint32_t clientId) {
+    std::vector<PacketBuffer> recovered;
+    {
+        std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+        auto it = shard.connections.find(clientId);
+        if (it == shard.connections.end()) return;
+        it->second->recoverFecPackets(header, packet.data(), packet.size(), recovered);
+    }
+
+    // A rebuilt packet is its header and payload, as a bundle entry is
+    for (auto& rebuilt : recovered) {
+        WireHeader rebuiltHeader;
+        size_t headerSize = rebuiltHeader.decode(rebuilt.data(), rebuilt.size());
+        if (headerSize == 0 || rebuiltHeader.hasAck ||
+            (rebuiltHeader.flags & (WireHeader::BUNDLE | WireHeader::FEC))) {
+            std::cerr << "Invalid recovered packet" << std::endl;
+            continue;
         }
+        rebuilt.consume(headerSize);
+        processPacket(shard, rebuiltHeader, std::move(rebuilt), clientId, true);
+    }
+}
 
-        fragmentInfo.fragments[message.fragmentIndex] = message;
-        fragmentInfo.receivedFragments++;
+void NetworkManager::deliverPacket(Shard& shard, const WireHeader& header, PacketBuffer packet, uint32_t clientId) {
+    // Wrap the buffer as a message without copying it
+    NetworkMessageView message{};
+    message.buffer = std::move(packet);
+    message.clientId = clientId;
+    message.reliability = static_cast<PacketReliability>(header.reliability);
+    message.messageId = header.messageId;
+    message.fragmentIndex = header.fragmentIndex;
+    message.totalFragments = header.totalFragments;
+    message.isFragment = header.isFragment;
+    message.channel = header.channel;
+    message.timestamp = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
 
-        if (isFragmentComplete(fragmentInfo)) {
-            message = reassembleFragments(fragmentInfo);
-            fragmentMap_.erase(message.messageId);
-        } else {
+    // Fragments are copied to their offset in the message buffer; only a completed
+    // message continues, carrying the reassembled buffer
+    if (message.isFragment) {
+        PacketBuffer assembled;
+        auto result = shard.fragments.addFragment(clientId, message.messageId, message.fragmentIndex,
+                                                  message.totalFragments, message.data(), message.size(),
+                                                  assembled, std::chrono::steady_clock::now());
+        if (result != FragmentAssembler::Result::COMPLETE) {
             return; // Wait for more fragments
         }
+
+        message.buffer = std::move(assembled);
+        message.isFragment = false;
+        message.fragmentIndex = 0;
+        message.totalFragments = 1;
     }
 
-    // Update last activity
-    lastActivity_[clientId] = std::chrono::steady_clock::now();
+    // Process the message; the vector callback is kept for existing users and costs a copy
+    if (messageViewCallback_) {
+        messageViewCallback_(message);
+    }
 
-    // Process the message
     if (messageCallback_) {
-        messageCallback_(message);
+        NetworkMessage copy{};
+        copyMessage(message, copy);
+        messageCallback_(copy);
     }
 
-    std::lock_guard<std::mutex> lock(messageQueueMutex_);
-    messageQueue_.push(message);
+    enqueueMessage(std::move(message));
 }
 
-std::vector<NetworkMessage> NetworkManager::fragmentMessage(const NetworkMessage& message) {
-    std::vector<NetworkMessage> fragments;
-    size_t totalFragments = (message.data.size() + config_.fragmentSize - 1) / config_.fragmentSize;
-
-    for (size_t i = 0; i < totalFragments; ++i) {
-        NetworkMessage fragment;
-        fragment.messageId = message.messageId;
-        fragment.fragmentIndex = static_cast<uint32_t>(i);
-        fragment.totalFragments = static_cast<uint32_t>(totalFragments);
-        fragment.isFragment = true;
-        fragment.reliability = message.reliability;
-        fragment.timestamp = message.timestamp;
+void NetworkManager::acceptPacket(Shard& shard, uint32_t clientId, const WireHeader& header, PacketBuffer packet,
+                                  bool recovered) {
+    shard.releasedPackets.clear();
 
-        size_t start = i * config_.fragmentSize;
-        size_t end = std::min(start + config_.fragmentSize, message.data.size());
-        fragment.data.assign(message.data.begin() + start, message.data.begin() + end);
+    // Acks and keep-alives count as activity, not only delivered messages
+    shard.lastActivity[clientId] = std::chrono::steady_clock::now();
 
-        fragments.push_back(fragment);
+    std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+    auto it = shard.connections.find(clientId);
+    if (it != shard.connections.end()) {
+        it->second->processIncomingPacket(header, std::move(packet), shard.releasedPackets, recovered);
     }
-
-    return fragments;
 }
 
-NetworkMessage NetworkManager::reassembleFragments(FragmentInfo& fragmentInfo) {
-    NetworkMessage reassembled;
-    reassembled.messageId = fragmentInfo.fragments[0].messageId;
-    reassembled.reliability = fragmentInfo.fragments[0].reliability;
-    reassembled.timestamp = fragmentInfo.fragments[0].timestamp;
-    reassembled.isFragment = false;
+void NetworkManager::enqueueMessage(NetworkMessageView&& message) {
+    switch (config_.inboundOverflowPolicy) {
+        case InboundOverflowPolicy::DROP_OLDEST: {
+            NetworkMessageView oldest;
+            while (!messageQueue_->tryPush(std::move(message))) {
+                if (messageQueue_->tryPop(oldest)) {
+                    droppedMessages_++;
+                }
+            }
+            return;
+        }
 
-    // Calculate total size
-    size_t totalSize = 0;
-    for (const auto& fragment : fragmentInfo.fragments) {
-        totalSize += fragment.data.size();
-    }
+        case InboundOverflowPolicy::BLOCK:
+            // Backpressure: while this shard waits the kernel queue absorbs the burst
+            while (!messageQueue_->tryPush(std::move(message))) {
+                if (!running_) {
+                    droppedMessages_++;
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            return;
 
-    // Reserve space and copy data
-    reassembled.data.reserve(totalSize);
-    for (const auto& fragment : fragmentInfo.fragments) {
-        reassembled.data.insert(reassembled.data.end(), 
-            fragment.data.begin(), fragment.data.end());
+        default:
+            if (!messageQueue_->tryPush(std::move(message))) {
+                droppedMessages_++;
+            }
+            return;
     }
-
-    return reassembled;
 }
 
-void NetworkManager::updateStatistics() {
-    std::lock_guard<std::mutex> lock(connectionsMutex_);
+void NetworkManager::updateStatistics(Shard& shard) {
+    std::lock_guard<std::mutex> lock(shard.connectionsMutex);
     
     float totalLatency = 0.0f;
     float totalPacketLoss = 0.0f;
-    size_t connectionCount = connections_.size();
+    size_t connectionCount = shard.connections.size();
 
     if (connectionCount > 0) {
-        for (const auto& pair : connections_) {
+        for (const auto& pair : shard.connections) {
             totalLatency += pair.second->getRTT();
             totalPacketLoss += pair.second->getPacketLoss();
         }
 
-        averageLatency_ = totalLatency / connectionCount;
-        packetLoss_ = totalPacketLoss / connectionCount;
+        shard.averageLatency = totalLatency / connectionCount;
+        shard.packetLoss = totalPacketLoss / connectionCount;
     }
 }
 
-void NetworkManager::validatePacket(const std::vector<uint8_t>& data) {
+void NetworkManager::validatePacket(const uint8_t* data, size_t size) {
     // Implement packet validation logic here
     // This could include checksums, signatures, or other validation methods
 }
 
-void NetworkManager::logPacket(const std::vector<uint8_t>& data, bool isOutgoing) {
+void NetworkManager::logPacket(const uint8_t* data, size_t size, bool isOutgoing) {
+    std::lock_guard<std::mutex> lock(packetLogMutex_);
     if (!packetLog_.is_open()) return;
 
     auto now = std::chrono::system_clock::now();
@@ -365,83 +857,101 @@ void NetworkManager::logPacket(const std::vector<uint8_t>& data, bool isOutgoing
     
     packetLog_ << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << " "
                << (isOutgoing ? "OUT" : "IN ") << " "
-               << data.size() << " bytes\n";
+               << size << " bytes\n";
 
     // Log first 16 bytes in hex
-    for (size_t i = 0; i < std::min(data.size(), size_t(16)); ++i) {
+    for (size_t i = 0; i < std::min(size, size_t(16)); ++i) {
         packetLog_ << std::hex << std::setw(2) << std::setfill('0') 
                   << static_cast<int>(data[i]) << " ";
     }
     packetLog_ << std::dec << "\n\n";
 }
 
-void NetworkManager::handleKeepAlive() {
+void NetworkManager::handleKeepAlive(Shard& shard) {
+    if (config_.keepAliveInterval == 0) return;
+
     auto now = std::chrono::steady_clock::now();
-    if (now - lastKeepAlive_ >= std::chrono::milliseconds(config_.keepAliveInterval)) {
-        NetworkMessage keepAlive;
-        keepAlive.data = {0}; // Empty keep-alive packet
-        keepAlive.reliability = PacketReliability::RELIABLE;
-        send(keepAlive);
-        lastKeepAlive_ = now;
+    if (now - shard.lastKeepAlive >= std::chrono::milliseconds(config_.keepAliveInterval)) {
+        // A bare header with no payload; the flush that follows sends it
+        std::lock_guard<std::mutex> lock(shard.connectionsMutex);
+        for (const auto& pair : shard.connections) {
+            pair.second->queueKeepAlive();
+        }
+        shard.lastKeepAlive = now;
     }
 }
 
-void NetworkManager::checkConnectionTimeouts() {
+void NetworkManager::checkConnectionTimeouts(Shard& shard) {
+    if (config_.connectionTimeout == 0) return;
+
+    // A quarter of the timeout between checks is precise enough
     auto now = std::chrono::steady_clock::now();
+    if (now < shard.nextTimeoutCheck) return;
+    shard.nextTimeoutCheck = now + std::chrono::milliseconds(std::max(config_.connectionTimeout / 4, 1u));
+
     std::vector<uint32_t> timeoutClients;
 
-    for (const auto& activity : lastActivity_) {
+    for (const auto& activity : shard.lastActivity) {
         if (now - activity.second >= std::chrono::milliseconds(config_.connectionTimeout)) {
             timeoutClients.push_back(activity.first);
         }
     }
 
     for (uint32_t clientId : timeoutClients) {
-        disconnectClient(clientId);
+        closeConnection(shard, clientId);
     }
 }
 
-void NetworkManager::cleanupExpiredFragments() {
-    auto now = std::chrono::steady_clock::now();
-    std::vector<uint32_t> expiredFragments;
-
-    std::lock_guard<std::mutex> lock(fragmentMutex_);
-    for (const auto& pair : fragmentMap_) {
-        if (now - pair.second.timestamp >= std::chrono::milliseconds(config_.fragmentTimeout)) {
-            expiredFragments.push_back(pair.first);
-        }
-    }
+void NetworkManager::closeConnection(Shard& shard, uint32_t clientId) {
+    // The application may have disconnected the client itself meanwhile
+    bool connected = isClientConnected(clientId);
+    disconnectClient(clientId);
+    shard.lastActivity.erase(clientId);
 
-    for (uint32_t messageId : expiredFragments) {
-        fragmentMap_.erase(messageId);
+    if (connected && disconnectCallback_) {
+        disconnectCallback_(clientId);
     }
 }
 
-std::vector<uint8_t> NetworkManager::processOutgoingData(const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> processedData = data;
-
-    // Apply compression if enabled
+bool NetworkManager::processOutgoingData(PacketBuffer& buffer, WireHeader& header) {
+    // Apply compression if enabled; it cannot run in place, so it fills a second
+    // pooled buffer and keeps the original when the result would not be smaller
     if (config_.enableCompression) {
-        processedData = Compression::compress(processedData, config_.compressionAlgorithm);
+        PacketBuffer compressed = bufferPool_->acquire(buffer.size());
+        uint8_t* output = compressed.append(buffer.size());
+        size_t compressedSize = Compression::compress(buffer.data(), buffer.size(), output,
+                                                      compressed.size(), config_.compressionAlgorithm);
+        if (compressedSize > 0) {
+            compressed.resize(compressedSize);
+            buffer = std::move(compressed);
+            header.flags |= WireHeader::COMPRESSED;
+        }
     }
 
     // Apply encryption if enabled
     if (config_.enableEncryption) {
         // Generate a new IV for each message
-        std::vector<uint8_t> iv = Crypto::generateIV();
-        
-        // Encrypt the data
-        processedData = Crypto::encrypt(processedData, config_.encryptionKey, iv, config_.encryptionMode);
-        
-        // Prepend the IV to the encrypted data
-        processedData.insert(processedData.begin(), iv.begin(), iv.end());
-    }
+        uint8_t iv[Crypto::IV_SIZE];
+        Crypto::generateIV(iv);
 
-    return processedData;
-}
+        // Encrypt in place; padding and tag go into tailroom
+        try {
+            size_t encryptedSize = Crypto::encrypt(buffer.data(), buffer.size(), buffer.size() + buffer.tailroom(),
+                                                   config_.encryptionKey, iv, config_.encryptionMode);
+            buffer.resize(encryptedSize);
+        } catch (const std::exception& e) {
+            std::cerr << "Encryption failed: " << e.what() << std::endl;
+            return false;
+        }
 
-bool NetworkManager::isFragmentComplete(const FragmentInfo& fragmentInfo) const {
-    return fragmentInfo.receivedFragments == fragmentInfo.totalFragments;
+        // Prepend the IV into headroom instead of shifting the ciphertext
+        uint8_t* ivHeader = buffer.prepend(Crypto::IV_SIZE);
+        if (!ivHeader) return false;
+        std::memcpy(ivHeader, iv, Crypto::IV_SIZE);
+        header.flags |= WireHeader::ENCRYPTED;
+    }
+
+    return true;
 }
 
 } // namespace BarrenEngine 
\ No newline at end of file
@@ -4,46 +4,485 @@
 
 namespace BarrenEngine {
 
+namespace {
+
+size_t lowestLevel(uint32_t levels) {
+    size_t level = 0;
+    while (!(levels & (1u << level))) {
+        ++level;
+    }
+    return level;
+}
+
+} // namespace
+
+void PacketRing::push(PrioritizedPacket&& packet) {
+    if (count_ == slots_.size()) {
+        // Unroll into a ring twice the size, oldest first
+        std::vector<PrioritizedPacket> slots(std::max<size_t>(slots_.size() * 2, 16));
+        for (size_t i = 0; i < count_; ++i) {
+            slots[i] = std::move(slots_[(head_ + i) & (slots_.size() - 1)]);
+        }
+        slots_.swap(slots);
+        head_ = 0;
+    }
+    slots_[(head_ + count_) & (slots_.size() - 1)] = std::move(packet);
+    count_++;
+}
+
+void PacketRing::pop() {
+    // Free what the slot still holds, such as an expired packet's payload
+    slots_[head_] = PrioritizedPacket();
+    head_ = (head_ + 1) & (slots_.size() - 1);
+    count_--;
+}
+
+void TokenBucket::configure(double rate, double burst, std::chrono::steady_clock::time_point now) {
+    rate_ = rate;
+    burst_ = burst;
+    tokens_ = burst;
+    lastRefill_ = now;
+}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now) {
+    if (rate_ <= 0.0 || now <= lastRefill_) return;
+    double elapsed = std::chrono::duration<double>(now - lastRefill_).count();
+    tokens_ = std::min(tokens_ + rate_ * elapsed, burst_);
+    lastRefill_ = now;
+}
+
+std::chrono::steady_clock::duration TokenBucket::getWaitTime(size_t bytes) const {
+    double needed = std::min(static_cast<double>(bytes), burst_);
+    if (rate_ <= 0.0 || tokens_ >= needed) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    // Round up so a retry after the wait always finds the tokens there
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((needed - tokens_) / rate_)) + std::chrono::steady_clock::duration(1);
+}
+
 // Implementation of bandwidth management
 void PacketScheduler::updateBandwidthUsage(size_t bytes) {
-    currentBandwidth_ = bytes;
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    auto now = std::chrono::steady_clock::now();
+    bucket_.refill(now);
+    bucket_.take(bytes);
+    charge(bytes, now);
+}
+
+void PacketScheduler::charge(size_t bytes, std::chrono::steady_clock::time_point now) {
+    meterBytes_ += bytes;
+    auto elapsed = now - meterStart_;
+    if (elapsed >= std::chrono::seconds(1)) {
+        currentBandwidth_ = static_cast<size_t>(meterBytes_ / std::chrono::duration<double>(elapsed).count());
+        meterBytes_ = 0;
+        meterStart_ = now;
+    }
+}
+
+double PacketScheduler::getBurst(size_t bandwidth, size_t burstSize) {
+    double burst = burstSize > 0 ? static_cast<double>(burstSize) : static_cast<double>(bandwidth) * BURST_TIME;
+    return std::max(burst, MIN_BURST);
 }
 
 bool PacketScheduler::enqueuePacket(const std::vector<uint8_t>& data, const PacketMetadata& metadata) {
-    std::lock_guard<std::mutex> lock(queueMutex_);
-    
-    if (packetQueue_.size() >= maxQueueSize_) {
+    return enqueuePacket(std::vector<uint8_t>(data), metadata);
+}
+
+bool PacketScheduler::enqueuePacket(std::vector<uint8_t>&& data, const PacketMetadata& metadata) {
+    size_t level = static_cast<size_t>(metadata.priority);
+    if (level >= PRIORITY_LEVELS || static_cast<size_t>(metadata.qos) >= QOS_LEVELS) {
         return false;
     }
 
-    packetQueue_.emplace(data, metadata);
+    // Reserve a place first, so racing producers never overshoot the limit
+    if (queueSize_.fetch_add(1) >= maxQueueSize_) {
+        queueSize_--;
+
+        // Make room from expired packets before turning this one away,
+        // unless the consumer is busy anyway
+        std::unique_lock<std::mutex> lock(queueMutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextSweep_) {
+            drainIngress();
+            sweepExpired(now);
+        }
+        if (queueSize_.fetch_add(1) >= maxQueueSize_) {
+            queueSize_--;
+            return false;
+        }
+    }
+
+    PrioritizedPacket packet(std::move(data), metadata);
+    while (!ingress_[level]->tryPush(std::move(packet))) {
+        // The consumer fell a whole ring behind; do its share of the work
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        drainIngress();
+    }
     return true;
 }
 
+void PacketScheduler::drainIngress() {
+    PrioritizedPacket packet;
+    for (auto& ring : ingress_) {
+        while (ring->tryPop(packet)) {
+            admit(std::move(packet));
+        }
+    }
+}
+
+void PacketScheduler::admit(PrioritizedPacket&& packet) {
+    const PacketMetadata& metadata = packet.getMetadata();
+    size_t level = static_cast<size_t>(metadata.priority);
+    Level& state = levels_[level];
+    nonEmptyLevels_ |= 1u << level;
+
+    if (metadata.qos == QoSLevel::ULTRA_LOW_LATENCY) {
+        state.deadlines.push_back({ std::move(packet), deadlineOrder_++ });
+        std::push_heap(state.deadlines.begin(), state.deadlines.end(), laterDeadline);
+        return;
+    }
+
+    // A flow joins the end of the round with nothing carried over
+    std::unique_ptr<Flow>& flow = state.flows[metadata.clientId];
+    if (!flow) {
+        flow = std::make_unique<Flow>();
+        flow->clientId = metadata.clientId;
+        flow->quantum = getQuantum(metadata.clientId);
+        if (state.tail) {
+            state.tail->next = flow.get();
+        } else {
+            state.head = flow.get();
+        }
+        state.tail = flow.get();
+    }
+    flow->packets.push(std::move(packet));
+}
+
 bool PacketScheduler::dequeuePacket(std::vector<uint8_t>& data, PacketMetadata& metadata) {
+    std::chrono::steady_clock::duration wait;
+    return dequeuePacket(data, metadata, wait) == DequeueResult::PACKET;
+}
+
+PacketScheduler::DequeueResult PacketScheduler::dequeuePacket(std::vector<uint8_t>& data, PacketMetadata& metadata,
+                                                              std::chrono::steady_clock::duration& wait) {
     std::lock_guard<std::mutex> lock(queueMutex_);
-    
-    if (packetQueue_.empty()) {
-        return false;
+    auto now = std::chrono::steady_clock::now();
+    bucket_.refill(now);
+    for (auto& bucket : qosBuckets_) {
+        bucket.refill(now);
+    }
+    drainIngress();
+    if (now >= nextSweep_) {
+        sweepExpired(now);
     }
+    return takeNext(now, data, metadata, wait);
+}
 
-    const auto& packet = packetQueue_.top();
-    
-    // Check if packet has expired
-    if (packet.getMetadata().deadline < std::chrono::steady_clock::now()) {
-        packetQueue_.pop();
-        return dequeuePacket(data, metadata); // Try next packet
+size_t PacketScheduler::dequeueBatch(std::vector<PrioritizedPacket>& packets, size_t maxPackets) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    auto now = std::chrono::steady_clock::now();
+    bucket_.refill(now);
+    for (auto& bucket : qosBuckets_) {
+        bucket.refill(now);
+    }
+    drainIngress();
+    if (now >= nextSweep_) {
+        sweepExpired(now);
     }
 
-    data = packet.getData();
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    std::chrono::steady_clock::duration wait;
+    size_t count = 0;
+    while (count < maxPackets && takeNext(now, data, metadata, wait) == DequeueResult::PACKET) {
+        packets.emplace_back(std::move(data), metadata);
+        count++;
+    }
+    return count;
+}
+
+PacketScheduler::DequeueResult PacketScheduler::takeNext(std::chrono::steady_clock::time_point now,
+                                                         std::vector<uint8_t>& data, PacketMetadata& metadata,
+                                                         std::chrono::steady_clock::duration& wait) {
+
+    // Highest non-empty level first, and within it the earliest deadline,
+    // then the flow whose turn it is. A packet out of its QoS class's tokens
+    // makes way for the next one of another class: the deadline heap for the
+    // round, a flow for the flows after it. Once the overall bucket runs
+    // dry nothing below may go.
+    auto earliest = std::chrono::steady_clock::duration::max();
+    bool linkLimited = false;
+    uint32_t candidates = nonEmptyLevels_;
+    while (candidates != 0 && !linkLimited) {
+        size_t level = lowestLevel(candidates);
+        candidates &= ~(1u << level);
+        Level& state = levels_[level];
+        expireDeadlines(state, now);
+
+        if (!state.deadlines.empty()) {
+            PrioritizedPacket& packet = state.deadlines.front().packet;
+            auto packetWait = getWaitTime(packet, linkLimited);
+            if (packetWait == std::chrono::steady_clock::duration::zero()) {
+                takePacket(packet, now, data, metadata);
+                popDeadline(state);
+                if (!state.head && state.deadlines.empty()) {
+                    nonEmptyLevels_ &= ~(1u << level);
+                }
+                return DequeueResult::PACKET;
+            }
+            earliest = std::min(earliest, packetWait);
+            if (linkLimited) break;
+        }
+
+        // Stop once the first flow that yielded comes up again
+        Flow* firstYielded = nullptr;
+        while (Flow* flow = selectFlow(state, now)) {
+            PrioritizedPacket& packet = flow->packets.front();
+            auto packetWait = getWaitTime(packet, linkLimited);
+            if (packetWait == std::chrono::steady_clock::duration::zero()) {
+                flow->deficit -= packet.getData().size();
+                takePacket(packet, now, data, metadata);
+                popPacket(state, *flow);
+                if (!state.head && state.deadlines.empty()) {
+                    nonEmptyLevels_ &= ~(1u << level);
+                }
+                return DequeueResult::PACKET;
+            }
+            earliest = std::min(earliest, packetWait);
+            if (linkLimited || flow == firstYielded) break;
+            if (!firstYielded) firstYielded = flow;
+            yieldTurn(state, *flow);
+        }
+
+        if (!state.head && state.deadlines.empty()) {
+            nonEmptyLevels_ &= ~(1u << level);
+        }
+    }
+
+    if (earliest != std::chrono::steady_clock::duration::max()) {
+        wait = earliest;
+        return DequeueResult::THROTTLED;
+    }
+    return DequeueResult::EMPTY;
+}
+
+std::chrono::steady_clock::duration PacketScheduler::getWaitTime(const PrioritizedPacket& packet,
+                                                                 bool& linkLimited) const {
+    if (packet.getMetadata().priority == PacketPriority::CRITICAL) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    size_t bytes = packet.getData().size();
+    auto linkWait = bucket_.getWaitTime(bytes);
+    auto classWait = qosBuckets_[static_cast<size_t>(packet.getMetadata().qos)].getWaitTime(bytes);
+    linkLimited = linkWait > std::chrono::steady_clock::duration::zero();
+    return std::max(linkWait, classWait);
+}
+
+void PacketScheduler::takePacket(PrioritizedPacket& packet, std::chrono::steady_clock::time_point now,
+                                 std::vector<uint8_t>& data, PacketMetadata& metadata) {
+    size_t bytes = packet.getData().size();
+    bucket_.take(bytes);
+    qosBuckets_[static_cast<size_t>(packet.getMetadata().qos)].take(bytes);
+    charge(bytes, now);
+    data = std::move(packet.getData());
     metadata = packet.getMetadata();
-    packetQueue_.pop();
-    
-    return true;
+}
+
+PacketScheduler::Flow* PacketScheduler::selectFlow(Level& level, std::chrono::steady_clock::time_point now) {
+    while (Flow* flow = level.head) {
+        // Expired packets cost the flow nothing
+        while (!flow->packets.empty() && flow->packets.front().getMetadata().deadline < now) {
+            countExpired(flow->packets.front());
+            popPacket(level, *flow);
+            if (level.head != flow) break;
+        }
+        if (level.head != flow) continue;
+
+        // Credit the quantum once per round; the flow keeps its turn for as
+        // long as the credit covers its next packet
+        if (!flow->quantumAdded) {
+            flow->deficit += flow->quantum;
+            flow->quantumAdded = true;
+        }
+        if (flow->deficit >= flow->packets.front().getData().size()) {
+            return flow;
+        }
+
+        // Out of credit: to the back of the round, keeping the remainder
+        flow->quantumAdded = false;
+        yieldTurn(level, *flow);
+    }
+    return nullptr;
+}
+
+void PacketScheduler::yieldTurn(Level& level, Flow& flow) {
+    // Moves the head flow to the back of the round; its credit stays with it
+    if (flow.next) {
+        level.head = flow.next;
+        flow.next = nullptr;
+        level.tail->next = &flow;
+        level.tail = &flow;
+    }
+}
+
+void PacketScheduler::popPacket(Level& level, Flow& flow) {
+    flow.packets.pop();
+    queueSize_--;
+    if (flow.packets.empty()) {
+        leaveRound(level, nullptr, flow);
+    }
+}
+
+void PacketScheduler::leaveRound(Level& level, Flow* previous, Flow& flow) {
+    if (previous) {
+        previous->next = flow.next;
+    } else {
+        level.head = flow.next;
+    }
+    if (level.tail == &flow) {
+        level.tail = previous;
+    }
+
+    // An idle flow is forgotten, so it takes no credit into a later round and
+    // clients that stopped sending cost nothing
+    level.flows.erase(flow.clientId);
+}
+
+void PacketScheduler::popDeadline(Level& level) {
+    std::pop_heap(level.deadlines.begin(), level.deadlines.end(), laterDeadline);
+    level.deadlines.pop_back();
+    queueSize_--;
+}
+
+void PacketScheduler::expireDeadlines(Level& level, std::chrono::steady_clock::time_point now) {
+    // The heap puts every expired packet on top
+    while (!level.deadlines.empty() && level.deadlines.front().packet.getMetadata().deadline < now) {
+        countExpired(level.deadlines.front().packet);
+        popDeadline(level);
+    }
+}
+
+void PacketScheduler::sweepExpired(std::chrono::steady_clock::time_point now) {
+    nextSweep_ = now + SWEEP_INTERVAL;
+    auto expired = [this, now](const PrioritizedPacket& packet) {
+        if (packet.getMetadata().deadline >= now) return false;
+        countExpired(packet);
+        return true;
+    };
+
+    for (size_t level = 0; level < PRIORITY_LEVELS; ++level) {
+        Level& state = levels_[level];
+        expireDeadlines(state, now);
+
+        Flow* previous = nullptr;
+        Flow* flow = state.head;
+        while (flow) {
+            Flow* next = flow->next;
+            queueSize_ -= flow->packets.removeIf(expired);
+            if (flow->packets.empty()) {
+                leaveRound(state, previous, *flow);
+            } else {
+                previous = flow;
+            }
+            flow = next;
+        }
+
+        if (!state.head && state.deadlines.empty()) {
+            nonEmptyLevels_ &= ~(1u << level);
+        }
+    }
+}
+
+void PacketScheduler::countExpired(const PrioritizedPacket& packet) {
+    expiredPackets_[static_cast<size_t>(packet.getMetadata().qos)]++;
+}
+
+bool PacketScheduler::laterDeadline(const DeadlinePacket& a, const DeadlinePacket& b) {
+    const auto& first = a.packet.getMetadata().deadline;
+    const auto& second = b.packet.getMetadata().deadline;
+    return first != second ? first > second : a.order > b.order;
+}
+
+size_t PacketScheduler::getQuantum(uint32_t clientId) const {
+    auto it = clientWeights_.find(clientId);
+    return quantum_ * (it != clientWeights_.end() ? it->second : 1);
+}
+
+void PacketScheduler::setQuantum(size_t bytes) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    quantum_ = std::max<size_t>(bytes, 1);
+    for (auto& level : levels_) {
+        for (auto& pair : level.flows) {
+            pair.second->quantum = getQuantum(pair.first);
+        }
+    }
+}
+
+void PacketScheduler::setClientWeight(uint32_t clientId, uint32_t weight) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    if (weight <= 1) {
+        clientWeights_.erase(clientId);
+    } else {
+        clientWeights_[clientId] = weight;
+    }
+    for (auto& level : levels_) {
+        auto it = level.flows.find(clientId);
+        if (it != level.flows.end()) {
+            it->second->quantum = getQuantum(clientId);
+        }
+    }
+}
+
+void PacketScheduler::removeClient(uint32_t clientId) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    drainIngress();
+    clientWeights_.erase(clientId);
+    for (auto& level : levels_) {
+        auto last = std::remove_if(level.deadlines.begin(), level.deadlines.end(),
+            [clientId](const DeadlinePacket& entry) { return entry.packet.getMetadata().clientId == clientId; });
+        if (last != level.deadlines.end()) {
+            queueSize_ -= level.deadlines.end() - last;
+            level.deadlines.erase(last, level.deadlines.end());
+            std::make_heap(level.deadlines.begin(), level.deadlines.end(), laterDeadline);
+        }
+
+        auto it = level.flows.find(clientId);
+        if (it == level.flows.end()) continue;
+
+        // Every flow with packets is in the round; leaving it frees them
+        Flow& flow = *it->second;
+        queueSize_ -= flow.packets.size();
+        Flow* previous = nullptr;
+        for (Flow* other = level.head; other != &flow; other = other->next) {
+            previous = other;
+        }
+        leaveRound(level, previous, flow);
+    }
 }
 
 void PacketScheduler::setMaxBandwidth(size_t bandwidth) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
     maxBandwidth_ = bandwidth;
+    bucket_.configure(static_cast<double>(bandwidth), getBurst(bandwidth, burstSize_), std::chrono::steady_clock::now());
+}
+
+void PacketScheduler::setBurstSize(size_t bytes) {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    burstSize_ = bytes;
+    bucket_.configure(static_cast<double>(maxBandwidth_), getBurst(maxBandwidth_, burstSize_),
+                      std::chrono::steady_clock::now());
+}
+
+void PacketScheduler::setQoSBandwidth(QoSLevel qos, size_t bandwidth, size_t burstSize) {
+    size_t index = static_cast<size_t>(qos);
+    if (index >= QOS_LEVELS) return;
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    qosBuckets_[index].configure(static_cast<double>(bandwidth), getBurst(bandwidth, burstSize),
+                                 std::chrono::steady_clock::now());
 }
 
 size_t PacketScheduler::getCurrentBandwidth() const {
@@ -51,8 +490,23 @@ size_t PacketScheduler::getCurrentBandwidth() const {
 }
 
 size_t PacketScheduler::getQueueSize() {
+    return queueSize_;
+}
+
+size_t PacketScheduler::getExpiredPackets() {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    size_t total = 0;
+    for (size_t count : expiredPackets_) {
+        total += count;
+    }
+    return total;
+}
+
+size_t PacketScheduler::getExpiredPackets(QoSLevel qos) {
+    size_t index = static_cast<size_t>(qos);
+    if (index >= QOS_LEVELS) return 0;
     std::lock_guard<std::mutex> lock(queueMutex_);
-    return packetQueue_.size();
+    return expiredPackets_[index];
 }
 
 } // namespace BarrenEngine 
\ No newline at end of file
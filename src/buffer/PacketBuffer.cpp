@@ -0,0 +1,307 @@
+#include "buffer/PacketBuffer.hpp"
+#include <cstring>
+#include <new>
+#include <unordered_set>
+
+namespace BarrenEngine {
+
+namespace {
+
+constexpr size_t CACHED_POOLS = 4;     // Pools a thread caches blocks for at once
+
+std::atomic<uint64_t> nextPoolId{1};
+
+// Ids of the pools still alive. A thread cache checks here before handing
+// blocks back, since its pool may be gone by the time the thread exits.
+// Deliberately leaked so threads exiting after static destruction can use it.
+struct PoolRegistry {
+    std::mutex mutex;
+    std::unordered_set<uint64_t> live;
+};
+
+PoolRegistry& getRegistry() {
+    static PoolRegistry* registry = new PoolRegistry();
+    return *registry;
+}
+
+} // namespace
+
+// Every thread's cached blocks, returned to their pools when it exits
+struct BufferPool::ThreadCache {
+    CacheSlot slots[CACHED_POOLS] = {};
+    size_t nextVictim = 0;
+
+    ~ThreadCache() {
+        for (CacheSlot& slot : slots) {
+            flush(slot);
+        }
+    }
+};
+
+PacketBuffer::PacketBuffer(const PacketBuffer& other)
+    : block_(other.block_)
+    , head_(other.head_)
+    , size_(other.size_)
+{
+    if (block_) {
+        block_->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept
+    : block_(other.block_)
+    , head_(other.head_)
+    , size_(other.size_)
+{
+    other.block_ = nullptr;
+    other.head_ = 0;
+    other.size_ = 0;
+}
+
+PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other) {
+    if (this != &other) {
+        if (other.block_) {
+            other.block_->refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        release();
+        block_ = other.block_;
+        head_ = other.head_;
+        size_ = other.size_;
+    }
+    return *this;
+}
+
+PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        block_ = other.block_;
+        head_ = other.head_;
+        size_ = other.size_;
+        other.block_ = nullptr;
+        other.head_ = 0;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+uint8_t* PacketBuffer::prepend(size_t length) {
+    if (!block_ || length > head_) return nullptr;
+    head_ -= static_cast<uint32_t>(length);
+    size_ += static_cast<uint32_t>(length);
+    return block_->payload() + head_;
+}
+
+uint8_t* PacketBuffer::append(size_t length) {
+    if (!block_ || length > tailroom()) return nullptr;
+    uint8_t* tail = block_->payload() + head_ + size_;
+    size_ += static_cast<uint32_t>(length);
+    return tail;
+}
+
+bool PacketBuffer::append(const uint8_t* source, size_t length) {
+    uint8_t* tail = append(length);
+    if (!tail) return false;
+    std::memcpy(tail, source, length);
+    return true;
+}
+
+void PacketBuffer::consume(size_t length) {
+    if (length > size_) length = size_;
+    head_ += static_cast<uint32_t>(length);
+    size_ -= static_cast<uint32_t>(length);
+}
+
+bool PacketBuffer::resize(size_t length) {
+    if (!block_ || length > size_ + tailroom()) return false;
+    size_ = static_cast<uint32_t>(length);
+    return true;
+}
+
+void PacketBuffer::release() {
+    if (!block_) return;
+
+    if (block_->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (block_->pool) {
+            block_->pool->recycle(block_);
+        } else {
+            block_->~Block();
+            delete[] reinterpret_cast<uint8_t*>(block_);
+        }
+    }
+    block_ = nullptr;
+    head_ = 0;
+    size_ = 0;
+}
+
+BufferPool::BufferPool(size_t payloadSize, size_t headroom, size_t tailroom, size_t initialBlocks)
+    : blockCapacity_(headroom + payloadSize + tailroom)
+    , headroom_(headroom)
+    , tailroom_(tailroom)
+    , id_(nextPoolId++)
+    , freeList_(nullptr)
+    , freeCount_(0)
+{
+    // Keep every block header on its own cache line boundary
+    blockStride_ = (PacketBuffer::HEADER_SIZE + blockCapacity_ + 63) & ~size_t(63);
+    if (initialBlocks > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        grow(initialBlocks);
+    }
+
+    PoolRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.live.insert(id_);
+}
+
+BufferPool::~BufferPool() {
+    // Exiting threads stop handing blocks back; blocks still sitting in
+    // thread caches are freed with the slabs
+    {
+        PoolRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.erase(id_);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (PacketBuffer::Block* block = freeList_; block; block = block->next) {
+        block->~Block();
+    }
+    freeList_ = nullptr;
+}
+
+PacketBuffer BufferPool::acquire(size_t payloadSize) {
+    PacketBuffer::Block* block = nullptr;
+
+    if (headroom_ + payloadSize + tailroom_ <= blockCapacity_) {
+        CacheSlot& slot = getCacheSlot();
+        if (!slot.blocks) {
+            refill(slot);
+        }
+        block = slot.blocks;
+        slot.blocks = block->next;
+        --slot.count;
+    } else {
+        // Rare oversized packet; freed straight back to the heap
+        size_t capacity = headroom_ + payloadSize + tailroom_;
+        uint8_t* storage = new uint8_t[PacketBuffer::HEADER_SIZE + capacity];
+        block = new (storage) PacketBuffer::Block();
+        block->capacity = static_cast<uint32_t>(capacity);
+        block->pool = nullptr;
+    }
+
+    block->next = nullptr;
+    block->refCount.store(1, std::memory_order_relaxed);
+    return PacketBuffer(block, static_cast<uint32_t>(headroom_));
+}
+
+size_t BufferPool::getBlockCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slabs_.size() * BLOCKS_PER_SLAB;
+}
+
+size_t BufferPool::getFreeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return freeCount_;
+}
+
+BufferPool& BufferPool::getDefault() {
+    static BufferPool pool(1500);
+    return pool;
+}
+
+void BufferPool::grow(size_t blocks) {
+    // Slabs are always BLOCKS_PER_SLAB blocks so the block count stays derivable
+    size_t slabCount = (blocks + BLOCKS_PER_SLAB - 1) / BLOCKS_PER_SLAB;
+    for (size_t s = 0; s < slabCount; ++s) {
+        std::unique_ptr<uint8_t[]> slab(new uint8_t[blockStride_ * BLOCKS_PER_SLAB + 63]);
+        uint8_t* base = reinterpret_cast<uint8_t*>(
+            (reinterpret_cast<uintptr_t>(slab.get()) + 63) & ~uintptr_t(63));
+
+        for (size_t i = 0; i < BLOCKS_PER_SLAB; ++i) {
+            auto* block = new (base + i * blockStride_) PacketBuffer::Block();
+            block->capacity = static_cast<uint32_t>(blockCapacity_);
+            block->pool = this;
+            block->next = freeList_;
+            freeList_ = block;
+        }
+        freeCount_ += BLOCKS_PER_SLAB;
+        slabs_.push_back(std::move(slab));
+    }
+}
+
+void BufferPool::recycle(PacketBuffer::Block* block) {
+    CacheSlot& slot = getCacheSlot();
+    block->next = slot.blocks;
+    slot.blocks = block;
+    if (++slot.count >= THREAD_CACHE_BLOCKS) {
+        spill(slot, THREAD_CACHE_BLOCKS / 2);
+    }
+}
+
+BufferPool::CacheSlot& BufferPool::getCacheSlot() {
+    thread_local ThreadCache cache;
+    for (CacheSlot& slot : cache.slots) {
+        if (slot.poolId == id_) return slot;
+    }
+
+    // Take a free slot, or hand back the blocks of one picked in turn
+    CacheSlot* slot = nullptr;
+    for (CacheSlot& candidate : cache.slots) {
+        if (candidate.poolId == 0) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (!slot) {
+        slot = &cache.slots[cache.nextVictim++ % CACHED_POOLS];
+        flush(*slot);
+    }
+    *slot = CacheSlot{this, id_, nullptr, 0};
+    return *slot;
+}
+
+void BufferPool::refill(CacheSlot& slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (freeCount_ < THREAD_CACHE_BLOCKS / 2) {
+        grow(THREAD_CACHE_BLOCKS / 2);
+    }
+    for (size_t i = 0; i < THREAD_CACHE_BLOCKS / 2; ++i) {
+        PacketBuffer::Block* block = freeList_;
+        freeList_ = block->next;
+        block->next = slot.blocks;
+        slot.blocks = block;
+    }
+    freeCount_ -= THREAD_CACHE_BLOCKS / 2;
+    slot.count += THREAD_CACHE_BLOCKS / 2;
+}
+
+void BufferPool::spill(CacheSlot& slot, size_t count) {
+    if (count == 0) return;
+
+    // Unlink the batch before taking the lock
+    PacketBuffer::Block* first = slot.blocks;
+    PacketBuffer::Block* last = first;
+    for (size_t i = 1; i < count; ++i) {
+        last = last->next;
+    }
+    slot.blocks = last->next;
+    slot.count -= count;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    last->next = freeList_;
+    freeList_ = first;
+    freeCount_ += count;
+}
+
+void BufferPool::flush(CacheSlot& slot) {
+    if (slot.poolId != 0) {
+        PoolRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (registry.live.count(slot.poolId)) {
+            slot.pool->spill(slot, slot.count);
+        }
+    }
+    slot = CacheSlot{};
+}
+
+} // namespace BarrenEngine
@@ -0,0 +1,265 @@
+#include "protocol/CongestionController.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace BarrenEngine {
+
+namespace {
+
+float seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<float>(duration).count();
+}
+
+// PROBE_BW gains: probe for more bandwidth for one RTT, drain the queue that
+// built for one, then cruise
+constexpr float PROBE_GAINS[] = { 1.25f, 0.75f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+
+} // namespace
+
+std::unique_ptr<CongestionController> CongestionController::create(CongestionAlgorithm algorithm,
+                                                                   size_t maxDatagramSize) {
+    switch (algorithm) {
+        case CongestionAlgorithm::CUBIC:
+            return std::make_unique<CubicController>(maxDatagramSize);
+        case CongestionAlgorithm::BBR:
+            return std::make_unique<BbrController>(maxDatagramSize);
+        case CongestionAlgorithm::NONE:
+        default:
+            return nullptr;
+    }
+}
+
+CubicController::CubicController(size_t maxDatagramSize)
+    : maxDatagramSize_(maxDatagramSize)
+    , window_(static_cast<double>(INITIAL_WINDOW_PACKETS * maxDatagramSize))
+    , slowStartThreshold_(HUGE_VAL)
+    , windowAtLoss_(0.0)
+    , renoWindow_(0.0)
+    , k_(0.0)
+    , inEpoch_(false)
+    , rtt_(0.0f)
+{
+}
+
+void CubicController::onAck(const AckSample& sample) {
+    rtt_ = sample.smoothedRtt;
+
+    // No growth for packets from before the last reduction, nor while the
+    // application leaves most of the window unused
+    if (sample.sendTime <= recoveryStart_ || sample.bytesInFlight * 2 < window_) {
+        return;
+    }
+
+    double bytes = static_cast<double>(sample.bytes);
+    if (window_ < slowStartThreshold_) {
+        window_ += bytes;
+        return;
+    }
+
+    double segment = static_cast<double>(maxDatagramSize_);
+    if (!inEpoch_) {
+        epochStart_ = sample.now;
+        inEpoch_ = true;
+        k_ = window_ < windowAtLoss_ ? std::cbrt((windowAtLoss_ - window_) / segment / C) : 0.0;
+        if (window_ >= windowAtLoss_) {
+            windowAtLoss_ = window_;
+        }
+        renoWindow_ = window_;
+    }
+
+    // Aim for where the curve will be one RTT from now, growing by at most half
+    double t = seconds(sample.now - epochStart_) + rtt_ - k_;
+    double target = windowAtLoss_ + C * t * t * t * segment;
+    target = std::min(std::max(target, window_), 1.5 * window_);
+
+    renoWindow_ += segment * (3.0 * (1.0 - BETA) / (1.0 + BETA)) * bytes / window_;
+    if (renoWindow_ > target) {
+        window_ = renoWindow_;
+    } else {
+        window_ += (target - window_) * bytes / window_;
+    }
+}
+
+void CubicController::onLoss(size_t, std::chrono::steady_clock::time_point sendTime,
+                             std::chrono::steady_clock::time_point now) {
+    if (sendTime <= recoveryStart_) {
+        return;
+    }
+    recoveryStart_ = now;
+    inEpoch_ = false;
+
+    // Fast convergence: a flow losing before its previous peak gives way
+    windowAtLoss_ = window_ < windowAtLoss_ ? window_ * (1.0 + BETA) / 2.0 : window_;
+    window_ = std::max(window_ * BETA, static_cast<double>(MIN_WINDOW_PACKETS * maxDatagramSize_));
+    slowStartThreshold_ = window_;
+}
+
+float CubicController::getPacingRate() const {
+    // Pace ahead of the window so pacing never becomes the limit, more so
+    // in slow start where the window doubles every round trip
+    if (rtt_ <= 0.0f) return 0.0f;
+    float gain = window_ < slowStartThreshold_ ? 2.0f : 1.2f;
+    return gain * static_cast<float>(window_) / rtt_;
+}
+
+BbrController::BbrController(size_t maxDatagramSize)
+    : maxDatagramSize_(maxDatagramSize)
+    , state_(State::STARTUP)
+    , window_(INITIAL_WINDOW_PACKETS * maxDatagramSize)
+    , roundBandwidth_()
+    , bandwidthSlot_(0)
+    , bandwidthRoundPending_(false)
+    , roundExtraAcked_()
+    , ackEpochBytes_(0)
+    , round_(0)
+    , nextRoundDelivered_(0)
+    , fullBandwidth_(0.0f)
+    , fullBandwidthRounds_(0)
+    , minRtt_(0.0f)
+    , nextMinRtt_(0.0f)
+    , cycleIndex_(0)
+    , pacingGain_(STARTUP_GAIN)
+    , bytesInFlight_(0)
+{
+}
+
+void BbrController::onAck(const AckSample& sample) {
+    bytesInFlight_ = sample.bytesInFlight > sample.bytes ? sample.bytesInFlight - sample.bytes : 0;
+
+    // A round ends when a packet sent after the previous round ended is acked
+    bool roundStart = false;
+    if (sample.deliveredAtSend >= nextRoundDelivered_) {
+        nextRoundDelivered_ = sample.delivered;
+        round_++;
+        bandwidthRoundPending_ = true;
+        roundExtraAcked_[round_ % BANDWIDTH_ROUNDS] = 0.0f;
+        roundStart = true;
+    }
+    updateBandwidth(sample);
+    updateAckAggregation(sample);
+
+    // Most samples include the time the peer held its ack back. When the
+    // minimum expires it moves to the lowest sample since, not the latest.
+    if (sample.rtt > 0.0f) {
+        if (minRtt_ == 0.0f || sample.rtt <= minRtt_) {
+            minRtt_ = sample.rtt;
+            minRttStamp_ = sample.now;
+            nextMinRtt_ = 0.0f;
+        } else if (seconds(sample.now - minRttStamp_) > MIN_RTT_EXPIRY) {
+            minRtt_ = nextMinRtt_ > 0.0f ? std::min(nextMinRtt_, sample.rtt) : sample.rtt;
+            minRttStamp_ = sample.now;
+            nextMinRtt_ = 0.0f;
+        } else if (nextMinRtt_ == 0.0f || sample.rtt < nextMinRtt_) {
+            nextMinRtt_ = sample.rtt;
+        }
+    }
+
+    switch (state_) {
+        case State::STARTUP:
+            // The pipe is full once three rounds in a row grew the bandwidth by less than a quarter
+            if (!roundStart) break;
+            if (getBandwidth() >= fullBandwidth_ * 1.25f) {
+                fullBandwidth_ = getBandwidth();
+                fullBandwidthRounds_ = 0;
+            } else if (++fullBandwidthRounds_ >= 3) {
+                state_ = State::DRAIN;
+                pacingGain_ = 1.0f / STARTUP_GAIN;
+            }
+            break;
+
+        case State::DRAIN:
+            // Drain the queue startup built before cruising
+            if (bytesInFlight_ <= getTargetWindow(1.0f)) {
+                state_ = State::PROBE_BW;
+                cycleIndex_ = 2;
+                cycleStart_ = sample.now;
+                pacingGain_ = PROBE_GAINS[cycleIndex_];
+            }
+            break;
+
+        case State::PROBE_BW:
+            if (seconds(sample.now - cycleStart_) > minRtt_) {
+                cycleIndex_ = (cycleIndex_ + 1) % CYCLE_LENGTH;
+                cycleStart_ = sample.now;
+                pacingGain_ = PROBE_GAINS[cycleIndex_];
+            }
+            break;
+    }
+
+    updateWindow(sample);
+}
+
+void BbrController::updateBandwidth(const AckSample& sample) {
+    // An app-limited sample shows what the application sent, not what the
+    // path carries, so it may raise the estimate but never age out a better one
+    if (sample.deliveryRate <= 0.0f || (sample.appLimited && sample.deliveryRate < getBandwidth())) {
+        return;
+    }
+    if (bandwidthRoundPending_) {
+        bandwidthSlot_ = (bandwidthSlot_ + 1) % BANDWIDTH_ROUNDS;
+        roundBandwidth_[bandwidthSlot_] = 0.0f;
+        bandwidthRoundPending_ = false;
+    }
+    float& best = roundBandwidth_[bandwidthSlot_];
+    best = std::max(best, sample.deliveryRate);
+}
+
+void BbrController::updateAckAggregation(const AckSample& sample) {
+    // Bytes acked since the epoch began beyond what the bandwidth accounts
+    // for. An epoch ends once the acks fall back behind the estimate.
+    float expected = getBandwidth() * seconds(sample.now - ackEpochStart_);
+    if (static_cast<float>(ackEpochBytes_) <= expected) {
+        ackEpochStart_ = sample.now;
+        ackEpochBytes_ = 0;
+        expected = 0.0f;
+    }
+    ackEpochBytes_ += sample.bytes;
+
+    float extra = std::min({ static_cast<float>(ackEpochBytes_) - expected, static_cast<float>(window_),
+                             getBandwidth() * MAX_AGGREGATION });
+    float& best = roundExtraAcked_[round_ % BANDWIDTH_ROUNDS];
+    best = std::max(best, extra);
+}
+
+void BbrController::updateWindow(const AckSample& sample) {
+    // Grow toward the target by what was acked; startup grows regardless
+    // until the initial window has been delivered once
+    size_t target = getTargetWindow(state_ == State::STARTUP ? STARTUP_GAIN : WINDOW_GAIN);
+    if (state_ != State::STARTUP) {
+        window_ = std::min(window_ + sample.bytes, target);
+    } else if (window_ < target || sample.delivered < INITIAL_WINDOW_PACKETS * maxDatagramSize_) {
+        window_ += sample.bytes;
+    }
+
+    // Never so small that a batch of held back acks stalls the flow
+    size_t minimum = MIN_PIPE_PACKETS * maxDatagramSize_ + static_cast<size_t>(getExtraAcked());
+    window_ = std::max(window_, minimum);
+}
+
+float BbrController::getPacingRate() const {
+    return pacingGain_ * getBandwidth();
+}
+
+float BbrController::getBandwidth() const {
+    return *std::max_element(roundBandwidth_, roundBandwidth_ + BANDWIDTH_ROUNDS);
+}
+
+float BbrController::getExtraAcked() const {
+    return *std::max_element(roundExtraAcked_, roundExtraAcked_ + BANDWIDTH_ROUNDS);
+}
+
+size_t BbrController::getBdp(float gain) const {
+    float bandwidth = getBandwidth();
+    if (bandwidth <= 0.0f || minRtt_ <= 0.0f) {
+        return INITIAL_WINDOW_PACKETS * maxDatagramSize_;
+    }
+    return static_cast<size_t>(gain * bandwidth * minRtt_);
+}
+
+size_t BbrController::getTargetWindow(float gain) const {
+    // The gain applies to the aggregation allowance too: while the peer
+    // batches its acks the window, not the path, bounds each round
+    return getBdp(gain) + static_cast<size_t>(gain * getExtraAcked());
+}
+
+} // namespace BarrenEngine
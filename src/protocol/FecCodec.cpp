@@ -0,0 +1,385 @@
+#include "protocol/FecCodec.hpp"
+#include <algorithm>
+#include <cstring>
+
+// The vector kernels are compiled for their instruction set whatever the
+// build targets and picked at runtime, so one binary runs everywhere
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BARREN_FEC_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace BarrenEngine {
+
+namespace {
+
+constexpr size_t LENGTH_SIZE = 2;
+
+// GF(256) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d)
+struct GaloisTables {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    GaloisTables() {
+        uint32_t value = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(value);
+            log[value] = static_cast<uint8_t>(i);
+            value <<= 1;
+            if (value & 0x100) value ^= 0x11d;
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+};
+
+const GaloisTables& tables() {
+    static const GaloisTables instance;
+    return instance;
+}
+
+uint8_t gfMul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+    const GaloisTables& t = tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+uint8_t gfInv(uint8_t a) {
+    const GaloisTables& t = tables();
+    return t.exp[255 - t.log[a]];
+}
+
+// Parity row j, data column i: a Cauchy matrix with x_j = j and y_i = 16 + i,
+// each column scaled so row 0 is all ones. Column scaling keeps every square
+// submatrix invertible, so any M losses can be solved for.
+uint8_t coefficient(uint8_t row, uint8_t column) {
+    uint8_t y = static_cast<uint8_t>(FecEncoder::MAX_PARITY_PACKETS + 1 + column);
+    return gfMul(y, gfInv(static_cast<uint8_t>(row ^ y)));
+}
+
+// A vector kernel multiplies whole 16 or 32 byte steps of source by the
+// factor whose products with every low and high nibble are given, xors them
+// into destination and returns how many bytes it covered
+using MulAddKernel = size_t (*)(uint8_t* destination, const uint8_t* source, const uint8_t* low,
+                                const uint8_t* high, size_t size);
+
+#ifdef BARREN_FEC_DISPATCH
+__attribute__((target("ssse3")))
+size_t mulAddSsse3(uint8_t* destination, const uint8_t* source, const uint8_t* low, const uint8_t* high,
+                   size_t size) {
+    __m128i lowTable = _mm_load_si128(reinterpret_cast<const __m128i*>(low));
+    __m128i highTable = _mm_load_si128(reinterpret_cast<const __m128i*>(high));
+    __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i product = _mm_xor_si128(
+            _mm_shuffle_epi8(lowTable, _mm_and_si128(in, mask)),
+            _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi64(in, 4), mask)));
+        __m128i out = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_xor_si128(out, product));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t mulAddAvx2(uint8_t* destination, const uint8_t* source, const uint8_t* low, const uint8_t* high,
+                  size_t size) {
+    __m256i lowTable = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(low)));
+    __m256i highTable = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(high)));
+    __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+        __m256i product = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lowTable, _mm256_and_si256(in, mask)),
+            _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(in, 4), mask)));
+        __m256i out = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_xor_si256(out, product));
+    }
+    return i + mulAddSsse3(destination + i, source + i, low, high, size - i);
+}
+#endif
+
+MulAddKernel selectKernel() {
+#ifdef BARREN_FEC_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return mulAddAvx2;
+    if (__builtin_cpu_supports("ssse3")) return mulAddSsse3;
+#endif
+    return nullptr;
+}
+
+// Chosen once; null leaves everything to the scalar loop
+MulAddKernel vectorKernel() {
+    static const MulAddKernel kernel = selectKernel();
+    return kernel;
+}
+
+// destination ^= factor * source. The vector kernels split every byte into
+// nibbles and look both products up with a shuffle, 16 or 32 bytes a step.
+void mulAdd(uint8_t* destination, const uint8_t* source, uint8_t factor, size_t size) {
+    if (factor == 0) return;
+
+    size_t i = 0;
+    if (factor == 1) {
+        for (; i + 8 <= size; i += 8) {
+            uint64_t a, b;
+            std::memcpy(&a, destination + i, 8);
+            std::memcpy(&b, source + i, 8);
+            a ^= b;
+            std::memcpy(destination + i, &a, 8);
+        }
+        for (; i < size; ++i) destination[i] ^= source[i];
+        return;
+    }
+
+    MulAddKernel kernel = vectorKernel();
+    if (kernel && size >= 16) {
+        alignas(16) uint8_t low[16];
+        alignas(16) uint8_t high[16];
+        for (uint8_t n = 0; n < 16; ++n) {
+            low[n] = gfMul(factor, n);
+            high[n] = gfMul(factor, static_cast<uint8_t>(n << 4));
+        }
+        i = kernel(destination, source, low, high, size);
+    }
+
+    const GaloisTables& t = tables();
+    uint8_t factorLog = t.log[factor];
+    for (; i < size; ++i) {
+        if (source[i]) destination[i] ^= t.exp[t.log[source[i]] + factorLog];
+    }
+}
+
+// Inverts a small matrix in place by Gauss-Jordan elimination. Cauchy
+// submatrices are never singular, so a zero pivot means corrupt input.
+bool invertMatrix(uint8_t* matrix, uint8_t* inverse, size_t n) {
+    for (size_t r = 0; r < n; ++r) {
+        for (size_t c = 0; c < n; ++c) {
+            inverse[r * n + c] = r == c ? 1 : 0;
+        }
+    }
+
+    for (size_t column = 0; column < n; ++column) {
+        size_t pivot = column;
+        while (pivot < n && matrix[pivot * n + column] == 0) ++pivot;
+        if (pivot == n) return false;
+        if (pivot != column) {
+            for (size_t c = 0; c < n; ++c) {
+                std::swap(matrix[pivot * n + c], matrix[column * n + c]);
+                std::swap(inverse[pivot * n + c], inverse[column * n + c]);
+            }
+        }
+
+        uint8_t scale = gfInv(matrix[column * n + column]);
+        for (size_t c = 0; c < n; ++c) {
+            matrix[column * n + c] = gfMul(matrix[column * n + c], scale);
+            inverse[column * n + c] = gfMul(inverse[column * n + c], scale);
+        }
+
+        for (size_t r = 0; r < n; ++r) {
+            uint8_t factor = matrix[r * n + column];
+            if (r == column || factor == 0) continue;
+            for (size_t c = 0; c < n; ++c) {
+                matrix[r * n + c] ^= gfMul(factor, matrix[column * n + c]);
+                inverse[r * n + c] ^= gfMul(factor, inverse[column * n + c]);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+FecEncoder::FecEncoder(BufferPool& pool, uint8_t dataCount, uint8_t parityCount, size_t maxSymbolSize)
+    : pool_(pool)
+    , dataCount_(dataCount < 1 ? 1 : (dataCount > MAX_DATA_PACKETS ? MAX_DATA_PACKETS : dataCount))
+    , parityCount_(parityCount < 1 ? 1 : (parityCount > MAX_PARITY_PACKETS ? MAX_PARITY_PACKETS : parityCount))
+    , maxSymbolSize_(maxSymbolSize)
+    , group_(0)
+    , index_(0)
+    , symbolSize_(0)
+{
+}
+
+bool FecEncoder::addPacket(WireHeader& header, const PacketBuffer& payload) {
+    // The symbol covers the header as it will be rebuilt, without acks or FEC fields
+    WireHeader inner = header;
+    inner.hasAck = false;
+    inner.flags &= static_cast<uint8_t>(~WireHeader::FEC);
+    uint8_t innerHeader[WireHeader::MAX_SIZE];
+    size_t headerSize = inner.encode(innerHeader, sizeof(innerHeader));
+    size_t length = headerSize + payload.size();
+    if (headerSize == 0 || LENGTH_SIZE + length > maxSymbolSize_ || length > UINT16_MAX) {
+        return false;
+    }
+
+    if (index_ == dataCount_) {
+        group_++;
+        index_ = 0;
+    }
+    if (index_ == 0) {
+        // Parity accumulates in place, so it starts out as zeros at full size
+        symbolSize_ = 0;
+        for (uint8_t j = 0; j < parityCount_; ++j) {
+            parity_[j] = pool_.acquire(maxSymbolSize_);
+            std::memset(parity_[j].append(maxSymbolSize_), 0, maxSymbolSize_);
+        }
+    }
+
+    uint8_t prefix[LENGTH_SIZE] = { static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8) };
+    for (uint8_t j = 0; j < parityCount_; ++j) {
+        uint8_t factor = coefficient(j, index_);
+        uint8_t* output = parity_[j].data();
+        mulAdd(output, prefix, factor, LENGTH_SIZE);
+        mulAdd(output + LENGTH_SIZE, innerHeader, factor, headerSize);
+        mulAdd(output + LENGTH_SIZE + headerSize, payload.data(), factor, payload.size());
+    }
+    symbolSize_ = std::max(symbolSize_, LENGTH_SIZE + length);
+
+    header.flags |= WireHeader::FEC;
+    header.fecGroup = group_;
+    header.fecIndex = index_;
+    header.fecDataCount = dataCount_;
+    header.fecParityCount = parityCount_;
+    index_++;
+    return true;
+}
+
+void FecEncoder::takeParity(uint8_t parityIndex, WireHeader& header, PacketBuffer& data) {
+    header = WireHeader();
+    header.flags = WireHeader::FEC;
+    header.fecGroup = group_;
+    header.fecIndex = static_cast<uint8_t>(dataCount_ + parityIndex);
+    header.fecDataCount = dataCount_;
+    header.fecParityCount = parityCount_;
+
+    data = std::move(parity_[parityIndex]);
+    data.resize(symbolSize_);
+}
+
+FecDecoder::FecDecoder(BufferPool& pool)
+    : pool_(pool)
+    , recoveredCount_(0)
+{
+}
+
+void FecDecoder::addPacket(const WireHeader& header, const uint8_t* payload, size_t size,
+                           std::vector<PacketBuffer>& recovered) {
+    Group* group = groups_.find(header.fecGroup);
+    if (!group) {
+        group = &groups_.insert(header.fecGroup);
+        group->dataCount = header.fecDataCount;
+        group->parityCount = header.fecParityCount;
+    }
+    if (group->done || group->dataCount != header.fecDataCount || group->parityCount != header.fecParityCount) {
+        return;
+    }
+
+    PacketBuffer& symbol = group->symbols[header.fecIndex];
+    if (symbol) return;
+
+    if (header.fecIndex < header.fecDataCount) {
+        // Rebuild the symbol the sender encoded: length, inner header, payload
+        WireHeader inner = header;
+        inner.hasAck = false;
+        inner.flags &= static_cast<uint8_t>(~WireHeader::FEC);
+        size_t headerSize = inner.getEncodedSize();
+        size_t length = headerSize + size;
+        if (length > UINT16_MAX) return;
+
+        symbol = pool_.acquire(LENGTH_SIZE + length);
+        uint8_t* output = symbol.append(LENGTH_SIZE + length);
+        output[0] = static_cast<uint8_t>(length);
+        output[1] = static_cast<uint8_t>(length >> 8);
+        inner.encode(output + LENGTH_SIZE, headerSize);
+        std::memcpy(output + LENGTH_SIZE + headerSize, payload, size);
+    } else {
+        symbol = pool_.acquire(size);
+        symbol.append(payload, size);
+    }
+
+    recover(*group, recovered);
+}
+
+void FecDecoder::recover(Group& group, std::vector<PacketBuffer>& recovered) {
+    uint8_t missing[FecEncoder::MAX_DATA_PACKETS];
+    uint8_t rows[FecEncoder::MAX_PARITY_PACKETS];
+    size_t missingCount = 0;
+    size_t rowCount = 0;
+    size_t symbolSize = 0;
+
+    for (uint8_t i = 0; i < group.dataCount; ++i) {
+        if (!group.symbols[i]) missing[missingCount++] = i;
+    }
+    for (uint8_t j = 0; j < group.parityCount; ++j) {
+        const PacketBuffer& parity = group.symbols[group.dataCount + j];
+        if (parity && rowCount < missingCount) {
+            rows[rowCount++] = j;
+            symbolSize = parity.size();
+        }
+    }
+
+    auto finish = [&group]() {
+        group.done = true;
+        for (auto& symbol : group.symbols) symbol.reset();
+    };
+    if (missingCount == 0) {
+        finish();
+        return;
+    }
+    if (rowCount < missingCount) {
+        return;
+    }
+
+    // Take the received data out of each parity row, leaving a small system
+    // in the missing symbols only
+    PacketBuffer remainders[FecEncoder::MAX_PARITY_PACKETS];
+    for (size_t r = 0; r < rowCount; ++r) {
+        const PacketBuffer& parity = group.symbols[group.dataCount + rows[r]];
+        if (parity.size() != symbolSize) return;
+        remainders[r] = pool_.acquire(symbolSize);
+        remainders[r].append(parity.data(), symbolSize);
+        for (uint8_t i = 0; i < group.dataCount; ++i) {
+            const PacketBuffer& data = group.symbols[i];
+            if (!data) continue;
+            if (data.size() > symbolSize) return;
+            mulAdd(remainders[r].data(), data.data(), coefficient(rows[r], i), data.size());
+        }
+    }
+
+    uint8_t matrix[FecEncoder::MAX_PARITY_PACKETS * FecEncoder::MAX_PARITY_PACKETS];
+    uint8_t inverse[FecEncoder::MAX_PARITY_PACKETS * FecEncoder::MAX_PARITY_PACKETS];
+    for (size_t r = 0; r < missingCount; ++r) {
+        for (size_t c = 0; c < missingCount; ++c) {
+            matrix[r * missingCount + c] = coefficient(rows[r], missing[c]);
+        }
+    }
+    if (!invertMatrix(matrix, inverse, missingCount)) {
+        finish();
+        return;
+    }
+
+    for (size_t m = 0; m < missingCount; ++m) {
+        PacketBuffer symbol = pool_.acquire(symbolSize);
+        std::memset(symbol.append(symbolSize), 0, symbolSize);
+        for (size_t r = 0; r < rowCount; ++r) {
+            mulAdd(symbol.data(), remainders[r].data(), inverse[m * missingCount + r], symbolSize);
+        }
+
+        size_t length = symbol.data()[0] | (symbol.data()[1] << 8);
+        if (length == 0 || LENGTH_SIZE + length > symbolSize) continue;
+        symbol.consume(LENGTH_SIZE);
+        symbol.resize(length);
+        recovered.push_back(std::move(symbol));
+        recoveredCount_++;
+    }
+    finish();
+}
+
+} // namespace BarrenEngine
@@ -0,0 +1,108 @@
+#include "protocol/FragmentAssembler.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace BarrenEngine {
+
+FragmentAssembler::FragmentAssembler(BufferPool& pool, uint32_t fragmentSize, uint32_t maxMessageSize, uint32_t timeoutMs,
+                                     size_t maxPendingBytes)
+    : pool_(pool)
+    , fragmentSize_(fragmentSize)
+    , maxMessageSize_(maxMessageSize > 0 ? maxMessageSize : DEFAULT_MAX_MESSAGE_SIZE)
+    , timeout_(timeoutMs > 0 ? timeoutMs : DEFAULT_TIMEOUT_MS)
+    , maxPendingBytes_(std::max<size_t>(maxPendingBytes > 0 ? maxPendingBytes : DEFAULT_MAX_PENDING_BYTES,
+                                        maxMessageSize_))
+    , pendingBytes_(0)
+    , expiredCount_(0)
+{
+}
+
+FragmentAssembler::Result FragmentAssembler::addFragment(uint32_t clientId, uint32_t messageId,
+                                                         uint32_t fragmentIndex, uint32_t totalFragments,
+                                                         const uint8_t* data, size_t size, PacketBuffer& output,
+                                                         std::chrono::steady_clock::time_point now) {
+    if (fragmentSize_ == 0 || totalFragments == 0 || fragmentIndex >= totalFragments ||
+        size == 0 || size > fragmentSize_ ||
+        static_cast<uint64_t>(totalFragments) * fragmentSize_ > maxMessageSize_) {
+        return Result::REJECTED;
+    }
+
+    bool isLast = fragmentIndex == totalFragments - 1;
+    if (!isLast && size != fragmentSize_) {
+        return Result::REJECTED;
+    }
+
+    uint64_t key = makeKey(clientId, messageId);
+    auto it = pending_.find(key);
+    if (it == pending_.end()) {
+        size_t messageBytes = static_cast<size_t>(totalFragments) * fragmentSize_;
+        if (pending_.size() >= MAX_PENDING_MESSAGES || messageBytes > maxPendingBytes_ - pendingBytes_) {
+            return Result::REJECTED;
+        }
+
+        // Size the output for the whole message up front; the last fragment trims it
+        PendingMessage message;
+        message.buffer = pool_.acquire(messageBytes);
+        if (!message.buffer.append(messageBytes)) {
+            return Result::REJECTED;
+        }
+        pendingBytes_ += messageBytes;
+        message.received.assign((totalFragments + 63) / 64, 0);
+        message.totalFragments = totalFragments;
+        message.receivedFragments = 0;
+        message.lastFragmentSize = 0;
+        message.deadline = now + timeout_;
+
+        it = pending_.emplace(key, std::move(message)).first;
+        deadlines_.push_back({ it->second.deadline, key });
+    }
+
+    PendingMessage& message = it->second;
+    if (message.totalFragments != totalFragments) {
+        return Result::REJECTED;
+    }
+
+    uint64_t& word = message.received[fragmentIndex / 64];
+    uint64_t bit = uint64_t(1) << (fragmentIndex % 64);
+    if (word & bit) {
+        return Result::DUPLICATE;
+    }
+    word |= bit;
+
+    std::memcpy(message.buffer.data() + static_cast<size_t>(fragmentIndex) * fragmentSize_, data, size);
+    if (isLast) {
+        message.lastFragmentSize = static_cast<uint32_t>(size);
+    }
+
+    if (++message.receivedFragments < message.totalFragments) {
+        return Result::INCOMPLETE;
+    }
+
+    pendingBytes_ -= static_cast<size_t>(totalFragments) * fragmentSize_;
+    message.buffer.resize(static_cast<size_t>(totalFragments - 1) * fragmentSize_ + message.lastFragmentSize);
+    output = std::move(message.buffer);
+    pending_.erase(it);
+    return Result::COMPLETE;
+}
+
+void FragmentAssembler::expire(std::chrono::steady_clock::time_point now) {
+    while (!deadlines_.empty() && deadlines_.front().time <= now) {
+        const Deadline& deadline = deadlines_.front();
+
+        // Completed messages leave a stale entry; a reused id gets a later deadline
+        auto it = pending_.find(deadline.key);
+        if (it != pending_.end() && it->second.deadline == deadline.time) {
+            pendingBytes_ -= static_cast<size_t>(it->second.totalFragments) * fragmentSize_;
+            pending_.erase(it);
+            expiredCount_++;
+        }
+        deadlines_.pop_front();
+    }
+}
+
+std::chrono::steady_clock::time_point FragmentAssembler::getNextExpiry() const {
+    // Stale entries only cause an early, harmless wakeup
+    return deadlines_.empty() ? std::chrono::steady_clock::time_point::max() : deadlines_.front().time;
+}
+
+} // namespace BarrenEngine
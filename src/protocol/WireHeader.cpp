@@ -0,0 +1,189 @@
+#include "protocol/WireHeader.hpp"
+
+namespace BarrenEngine {
+
+namespace {
+
+constexpr uint8_t ACK_BIT = 0x04;
+constexpr uint8_t FRAGMENT_BIT = 0x02;
+constexpr uint8_t EXTENDED_BIT = 0x01;
+constexpr uint8_t MAX_RELIABILITY = 4;
+
+size_t varintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+uint8_t* writeVarint(uint8_t* output, uint32_t value) {
+    while (value >= 0x80) {
+        *output++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *output++ = static_cast<uint8_t>(value);
+    return output;
+}
+
+const uint8_t* readVarint(const uint8_t* data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && data < end; shift += 7) {
+        uint8_t byte = *data++;
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return data;
+    }
+    return nullptr;
+}
+
+uint8_t* writeU16(uint8_t* output, uint16_t value) {
+    output[0] = static_cast<uint8_t>(value);
+    output[1] = static_cast<uint8_t>(value >> 8);
+    return output + 2;
+}
+
+uint8_t* writeU32(uint8_t* output, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        output[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+    return output + 4;
+}
+
+uint16_t readU16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t readU32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+} // namespace
+
+size_t WireHeader::getEncodedSize() const {
+    size_t size = 1;
+    if (flags) size += 1;
+    if (hasSequence()) size += 2;
+    if (hasOrdering()) size += 3;
+    if (flags & FEC) size += 4;
+    if (hasAck) size += 6;
+    if (isFragment) {
+        size += varintSize(messageId) + varintSize(fragmentIndex) + varintSize(totalFragments);
+    }
+    return size;
+}
+
+size_t WireHeader::encode(uint8_t* output, size_t capacity) const {
+    if (reliability > MAX_RELIABILITY || getEncodedSize() > capacity ||
+        ((flags & FEC) && (fecDataCount > 15 || fecParityCount > 15))) {
+        return 0;
+    }
+
+    uint8_t* cursor = output;
+    *cursor++ = static_cast<uint8_t>((VERSION << 6) | (reliability << 3) |
+                                     (hasAck ? ACK_BIT : 0) |
+                                     (isFragment ? FRAGMENT_BIT : 0) |
+                                     (flags ? EXTENDED_BIT : 0));
+    if (flags) {
+        *cursor++ = flags;
+    }
+    if (hasSequence()) {
+        cursor = writeU16(cursor, sequence);
+    }
+    if (hasOrdering()) {
+        *cursor++ = channel;
+        cursor = writeU16(cursor, orderSequence);
+    }
+    if (flags & FEC) {
+        cursor = writeU16(cursor, fecGroup);
+        *cursor++ = fecIndex;
+        *cursor++ = static_cast<uint8_t>((fecDataCount << 4) | (fecParityCount & 0x0f));
+    }
+    if (hasAck) {
+        cursor = writeU16(cursor, ack);
+        cursor = writeU32(cursor, ackBits);
+    }
+    if (isFragment) {
+        cursor = writeVarint(cursor, messageId);
+        cursor = writeVarint(cursor, fragmentIndex);
+        cursor = writeVarint(cursor, totalFragments);
+    }
+    return static_cast<size_t>(cursor - output);
+}
+
+size_t WireHeader::decode(const uint8_t* data, size_t size) {
+    if (size < 1 || (data[0] >> 6) != VERSION) {
+        return 0;
+    }
+
+    const uint8_t* cursor = data;
+    const uint8_t* end = data + size;
+    uint8_t first = *cursor++;
+
+    reliability = static_cast<uint8_t>((first >> 3) & 0x07);
+    hasAck = (first & ACK_BIT) != 0;
+    isFragment = (first & FRAGMENT_BIT) != 0;
+    if (reliability > MAX_RELIABILITY) {
+        return 0;
+    }
+
+    flags = 0;
+    if (first & EXTENDED_BIT) {
+        if (cursor >= end) return 0;
+        flags = *cursor++;
+    }
+
+    sequence = 0;
+    if (hasSequence()) {
+        if (end - cursor < 2) return 0;
+        sequence = readU16(cursor);
+        cursor += 2;
+    }
+
+    channel = 0;
+    orderSequence = 0;
+    if (hasOrdering()) {
+        if (end - cursor < 3) return 0;
+        channel = *cursor;
+        orderSequence = readU16(cursor + 1);
+        cursor += 3;
+    }
+
+    fecGroup = 0;
+    fecIndex = 0;
+    fecDataCount = 0;
+    fecParityCount = 0;
+    if (flags & FEC) {
+        if (end - cursor < 4) return 0;
+        fecGroup = readU16(cursor);
+        fecIndex = cursor[2];
+        fecDataCount = static_cast<uint8_t>(cursor[3] >> 4);
+        fecParityCount = static_cast<uint8_t>(cursor[3] & 0x0f);
+        cursor += 4;
+        if (fecDataCount == 0 || fecParityCount == 0 || fecIndex >= fecDataCount + fecParityCount) return 0;
+    }
+
+    ack = 0;
+    ackBits = 0;
+    if (hasAck) {
+        if (end - cursor < 6) return 0;
+        ack = readU16(cursor);
+        ackBits = readU32(cursor + 2);
+        cursor += 6;
+    }
+
+    messageId = 0;
+    fragmentIndex = 0;
+    totalFragments = 0;
+    if (isFragment) {
+        cursor = readVarint(cursor, end, messageId);
+        if (cursor) cursor = readVarint(cursor, end, fragmentIndex);
+        if (cursor) cursor = readVarint(cursor, end, totalFragments);
+        if (!cursor) return 0;
+    }
+
+    return static_cast<size_t>(cursor - data);
+}
+
+} // namespace BarrenEngine
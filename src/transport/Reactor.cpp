@@ -0,0 +1,155 @@
+#include "transport/Reactor.hpp"
+#include <iostream>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace BarrenEngine {
+
+Reactor::Reactor()
+    : epollFd_(-1)
+    , eventFd_(-1)
+    , timerFd_(-1)
+    , wakeupPending_(false)
+    , armedDeadline_(std::chrono::steady_clock::time_point::max())
+{
+}
+
+Reactor::~Reactor() {
+    close();
+}
+
+bool Reactor::isOpen() const {
+    return epollFd_ >= 0;
+}
+
+#ifdef __linux__
+
+bool Reactor::open(int socketHandle) {
+    close();
+
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epollFd_ < 0 || eventFd_ < 0 || timerFd_ < 0) {
+        std::cerr << "Failed to create reactor: " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    const struct {
+        int fd;
+        Event event;
+    } sources[] = {
+        { socketHandle, SOCKET_READABLE },
+        { eventFd_, WAKEUP },
+        { timerFd_, TIMER }
+    };
+
+    for (const auto& source : sources) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = source.event;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, source.fd, &ev) < 0) {
+            std::cerr << "Failed to register reactor source: " << std::strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Reactor::close() {
+    for (int* fd : { &epollFd_, &eventFd_, &timerFd_ }) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    wakeupPending_ = false;
+    armedDeadline_ = std::chrono::steady_clock::time_point::max();
+}
+
+uint32_t Reactor::wait(int timeoutMs) {
+    if (epollFd_ < 0) return NONE;
+
+    epoll_event events[3];
+    int count = epoll_wait(epollFd_, events, 3, timeoutMs);
+    if (count < 0) {
+        return NONE; // EINTR: caller simply loops
+    }
+
+    uint32_t mask = NONE;
+    uint64_t value;
+    for (int i = 0; i < count; ++i) {
+        mask |= events[i].data.u32;
+    }
+
+    // Reset the level-triggered counters; the socket is drained by the caller.
+    // The eventfd is drained before the flag is cleared: a wakeup() in between
+    // then skips its write, but its work was queued before it and the caller
+    // handles queued work after every wait. Clearing first would let a drain
+    // swallow that write and leave the flag set, so no wakeup got through again.
+    if (mask & WAKEUP) {
+        while (::read(eventFd_, &value, sizeof(value)) > 0) {}
+        wakeupPending_ = false;
+    }
+    if (mask & TIMER) {
+        while (::read(timerFd_, &value, sizeof(value)) > 0) {}
+        armedDeadline_ = std::chrono::steady_clock::time_point::max();
+    }
+
+    return mask;
+}
+
+void Reactor::wakeup() {
+    if (eventFd_ < 0 || wakeupPending_.exchange(true)) return;
+
+    uint64_t one = 1;
+    ssize_t written = ::write(eventFd_, &one, sizeof(one));
+    (void)written;
+}
+
+void Reactor::setDeadline(std::chrono::steady_clock::time_point deadline) {
+    if (timerFd_ < 0 || deadline == armedDeadline_) return;
+
+    itimerspec spec{};
+    if (deadline != std::chrono::steady_clock::time_point::max()) {
+        // Relative arm; a zero it_value would disarm, so clamp to 1ns
+        auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (delay < 1) delay = 1;
+        spec.it_value.tv_sec = static_cast<time_t>(delay / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(delay % 1000000000);
+    }
+
+    timerfd_settime(timerFd_, 0, &spec, nullptr);
+    armedDeadline_ = deadline;
+}
+
+#else
+
+// Without epoll the reactor degrades to the old fixed polling interval
+bool Reactor::open(int) { epollFd_ = 0; return true; }
+void Reactor::close() { epollFd_ = -1; }
+
+uint32_t Reactor::wait(int) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    wakeupPending_ = false;
+    return SOCKET_READABLE | WAKEUP | TIMER;
+}
+
+void Reactor::wakeup() { wakeupPending_ = true; }
+void Reactor::setDeadline(std::chrono::steady_clock::time_point deadline) { armedDeadline_ = deadline; }
+
+#endif
+
+} // namespace BarrenEngine
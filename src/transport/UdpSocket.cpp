@@ -0,0 +1,280 @@
+#include "transport/UdpSocket.hpp"
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace BarrenEngine {
+
+UdpSocket::UdpSocket()
+    : fd_(-1)
+    , gsoEnabled_(false)
+    , groEnabled_(false)
+{
+}
+
+UdpSocket::~UdpSocket() {
+    close();
+}
+
+#ifdef __linux__
+
+bool UdpSocket::open(uint32_t bufferSize, bool reusePort) {
+    close();
+
+    // Dual-stack socket: IPv4 peers show up as v4-mapped IPv6 addresses
+    fd_ = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (fd_ < 0) {
+        std::cerr << "Failed to create UDP socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int off = 0;
+    setsockopt(fd_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    // Sharded servers bind several sockets to one port; the kernel hashes each 4-tuple to one of them
+    int on = 1;
+    if (reusePort && setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        std::cerr << "Failed to enable SO_REUSEPORT: " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    // Size kernel buffers for a full receive batch so bursts are not dropped
+    int kernelBuffer = static_cast<int>(std::max<size_t>(bufferSize * MAX_BATCH, 1 << 20));
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kernelBuffer, sizeof(kernelBuffer));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &kernelBuffer, sizeof(kernelBuffer));
+
+    return true;
+}
+
+bool UdpSocket::bind(uint16_t port) {
+    if (fd_ < 0) return false;
+
+    sockaddr_in6 address{};
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "Failed to bind UDP socket to port " << port << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    gsoEnabled_ = false;
+    groEnabled_ = false;
+}
+
+bool UdpSocket::enableSegmentationOffload() {
+    if (fd_ < 0) return false;
+
+    // UDP_SEGMENT is set per send via cmsg; setting the socket default to 0 probes support
+    int segment = 0;
+    int on = 1;
+    if (setsockopt(fd_, SOL_UDP, UDP_SEGMENT, &segment, sizeof(segment)) < 0 ||
+        setsockopt(fd_, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+        std::cerr << "UDP segmentation offload unavailable: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    gsoEnabled_ = true;
+    groEnabled_ = true;
+    return true;
+}
+
+int UdpSocket::receiveBatch(Datagram* datagrams, size_t count) {
+    if (fd_ < 0) return -1;
+    count = std::min(count, MAX_BATCH);
+
+    mmsghdr headers[MAX_BATCH];
+    iovec vectors[MAX_BATCH];
+    alignas(cmsghdr) uint8_t control[MAX_BATCH][CMSG_SPACE(sizeof(int))];
+    for (size_t i = 0; i < count; ++i) {
+        vectors[i].iov_base = datagrams[i].data;
+        vectors[i].iov_len = datagrams[i].capacity;
+        std::memset(&headers[i], 0, sizeof(mmsghdr));
+        headers[i].msg_hdr.msg_name = datagrams[i].endpoint.address;
+        headers[i].msg_hdr.msg_namelen = sizeof(datagrams[i].endpoint.address);
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        if (groEnabled_) {
+            headers[i].msg_hdr.msg_control = control[i];
+            headers[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+    }
+
+    int received;
+    do {
+        received = ::recvmmsg(fd_, headers, static_cast<unsigned int>(count), MSG_DONTWAIT, nullptr);
+    } while (received < 0 && errno == EINTR);
+
+    if (received < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    for (int i = 0; i < received; ++i) {
+        datagrams[i].size = headers[i].msg_len;
+        datagrams[i].segmentSize = 0;
+        datagrams[i].endpoint.length = headers[i].msg_hdr.msg_namelen;
+
+        // GRO: the kernel merged several same-sized datagrams into this slot
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr); cmsg;
+             cmsg = CMSG_NXTHDR(&headers[i].msg_hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int segmentSize;
+                std::memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+                if (segmentSize > 0 && static_cast<uint32_t>(segmentSize) < datagrams[i].size) {
+                    datagrams[i].segmentSize = static_cast<uint32_t>(segmentSize);
+                }
+            }
+        }
+    }
+    return received;
+}
+
+int UdpSocket::sendBatch(const Datagram* datagrams, size_t count) {
+    if (fd_ < 0) return -1;
+
+    constexpr size_t MAX_VECTORS = MAX_BATCH * 16;
+    mmsghdr headers[MAX_BATCH];
+    iovec vectors[MAX_VECTORS];
+    size_t segments[MAX_BATCH];
+    alignas(cmsghdr) uint8_t control[MAX_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    size_t totalSent = 0;
+
+    while (totalSent < count) {
+        size_t messages = 0;
+        size_t vectorCount = 0;
+        size_t next = totalSent;
+
+        while (next < count && messages < MAX_BATCH && vectorCount < MAX_VECTORS) {
+            const Datagram& first = datagrams[next];
+
+            // Extend a run of equal-sized datagrams to the same peer; a shorter
+            // datagram may close the run as the final segment
+            size_t run = 1;
+            size_t bytes = first.size;
+            if (gsoEnabled_ && first.size > 0 && first.size <= MAX_GSO_SEGMENT_SIZE) {
+                while (next + run < count && run < MAX_GSO_SEGMENTS && vectorCount + run < MAX_VECTORS) {
+                    const Datagram& candidate = datagrams[next + run];
+                    if (candidate.size == 0 || candidate.size > first.size ||
+                        bytes + candidate.size > MAX_GSO_BYTES || candidate.endpoint != first.endpoint) {
+                        break;
+                    }
+                    bytes += candidate.size;
+                    ++run;
+                    if (candidate.size < first.size) break;
+                }
+            }
+
+            mmsghdr& header = headers[messages];
+            std::memset(&header, 0, sizeof(mmsghdr));
+            header.msg_hdr.msg_name = const_cast<uint8_t*>(first.endpoint.address);
+            header.msg_hdr.msg_namelen = first.endpoint.length;
+            header.msg_hdr.msg_iov = &vectors[vectorCount];
+            header.msg_hdr.msg_iovlen = run;
+            for (size_t i = 0; i < run; ++i) {
+                vectors[vectorCount + i].iov_base = datagrams[next + i].data;
+                vectors[vectorCount + i].iov_len = datagrams[next + i].size;
+            }
+
+            if (run > 1) {
+                header.msg_hdr.msg_control = control[messages];
+                header.msg_hdr.msg_controllen = sizeof(control[messages]);
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&header.msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segmentSize = static_cast<uint16_t>(first.size);
+                std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+            }
+
+            segments[messages++] = run;
+            vectorCount += run;
+            next += run;
+        }
+
+        int sent = ::sendmmsg(fd_, headers, static_cast<unsigned int>(messages), MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (gsoEnabled_ && segments[0] > 1 && (errno == EINVAL || errno == EIO)) {
+                // The route cannot segment (e.g. no checksum offload); stop coalescing
+                gsoEnabled_ = false;
+                continue;
+            }
+            // Skip the offending message so one bad destination cannot stall the batch
+            if (totalSent + segments[0] < count) {
+                totalSent += segments[0];
+                continue;
+            }
+            return totalSent > 0 ? static_cast<int>(totalSent) : -1;
+        }
+        for (int i = 0; i < sent; ++i) {
+            totalSent += segments[i];
+        }
+    }
+
+    return static_cast<int>(totalSent);
+}
+
+bool UdpSocket::resolve(const std::string& address, uint16_t port, Endpoint& endpoint) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_V4MAPPED | AI_ADDRCONFIG;
+
+    addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(address.c_str(), service.c_str(), &hints, &result) != 0 || !result) {
+        std::cerr << "Failed to resolve address: " << address << std::endl;
+        return false;
+    }
+
+    std::memcpy(endpoint.address, result->ai_addr, std::min<size_t>(result->ai_addrlen, sizeof(endpoint.address)));
+    endpoint.length = static_cast<uint32_t>(std::min<size_t>(result->ai_addrlen, sizeof(endpoint.address)));
+    freeaddrinfo(result);
+    return true;
+}
+
+std::string UdpSocket::toString(const Endpoint& endpoint) {
+    char host[INET6_ADDRSTRLEN] = {};
+    const auto* address = reinterpret_cast<const sockaddr_in6*>(endpoint.address);
+    if (endpoint.length < sizeof(sockaddr_in6) ||
+        !inet_ntop(AF_INET6, &address->sin6_addr, host, sizeof(host))) {
+        return "<invalid>";
+    }
+    return "[" + std::string(host) + "]:" + std::to_string(ntohs(address->sin6_port));
+}
+
+#else
+
+// Non-Linux platforms route through the custom socket layer instead
+bool UdpSocket::open(uint32_t, bool) { return false; }
+bool UdpSocket::enableSegmentationOffload() { return false; }
+bool UdpSocket::bind(uint16_t) { return false; }
+void UdpSocket::close() { fd_ = -1; }
+int UdpSocket::receiveBatch(Datagram*, size_t) { return -1; }
+int UdpSocket::sendBatch(const Datagram*, size_t) { return -1; }
+bool UdpSocket::resolve(const std::string&, uint16_t, Endpoint&) { return false; }
+std::string UdpSocket::toString(const Endpoint&) { return "<unsupported>"; }
+
+#endif
+
+} // namespace BarrenEngine
@@ -0,0 +1,473 @@
+#include "transport/UringTransport.hpp"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace BarrenEngine {
+
+UringTransport::UringTransport()
+    : socket_(-1)
+    , ringFd_(-1)
+    , bufferSize_(0)
+    , receiveArmed_(false)
+    , sqRing_(nullptr)
+    , cqRing_(nullptr)
+    , sqes_(nullptr)
+    , sqRingSize_(0)
+    , cqRingSize_(0)
+    , sqesSize_(0)
+    , sqLocalTail_(0)
+    , sqHead_(nullptr)
+    , sqTail_(nullptr)
+    , sqMask_(nullptr)
+    , sqFlags_(nullptr)
+    , sqArray_(nullptr)
+    , cqHead_(nullptr)
+    , cqTail_(nullptr)
+    , cqMask_(nullptr)
+    , cqes_(nullptr)
+    , pendingSubmissions_(0)
+    , bufferRing_(nullptr)
+    , bufferRingSize_(0)
+    , bufferRingTail_(0)
+    , receiveArea_(nullptr)
+    , receiveAreaSize_(0)
+    , receiveSlotSize_(0)
+    , readyIndex_(0)
+    , receiveHeader_{}
+    , sendArea_(nullptr)
+    , sendAreaSize_(0)
+    , droppedDatagrams_(0)
+{
+}
+
+UringTransport::~UringTransport() {
+    close();
+}
+
+#ifdef __linux__
+
+namespace {
+
+constexpr uint64_t RECEIVE_TAG = 1ull << 63;
+constexpr uint64_t CANCEL_TAG = RECEIVE_TAG | 1;
+constexpr int CANCEL_WAIT_ATTEMPTS = 1000;     // Milliseconds close() waits for the kernel at most
+
+int uringSetup(uint32_t entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int uringRegister(int fd, uint32_t opcode, void* arg, uint32_t count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+void* mapAnonymous(size_t size) {
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+} // namespace
+
+bool UringTransport::open(int socketHandle, uint32_t bufferSize) {
+    close();
+    socket_ = socketHandle;
+    bufferSize_ = bufferSize;
+
+    if (!setupRing() || !setupBuffers()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool UringTransport::setupRing() {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP |
+                   IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG;
+    params.cq_entries = RING_ENTRIES * 4;
+
+    ringFd_ = uringSetup(RING_ENTRIES, &params);
+    if (ringFd_ < 0 && errno == EINVAL) {
+        // Pre-5.19 kernels reject the task-run flags
+        params = io_uring_params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+        params.cq_entries = RING_ENTRIES * 4;
+        ringFd_ = uringSetup(RING_ENTRIES, &params);
+    }
+    if (ringFd_ < 0) {
+        std::cerr << "io_uring_setup failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        std::cerr << "io_uring lacks single mmap support" << std::endl;
+        return false;
+    }
+
+    // Multishot recvmsg and zero-copy send both arrived in 6.0
+    std::vector<uint8_t> probeStorage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(probeStorage.data());
+    if (uringRegister(ringFd_, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+        probe->last_op < IORING_OP_SEND_ZC ||
+        !(probe->ops[IORING_OP_RECVMSG].flags & IO_URING_OP_SUPPORTED) ||
+        !(probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED)) {
+        std::cerr << "io_uring lacks multishot recvmsg or zero-copy send" << std::endl;
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        return false;
+    }
+    cqRing_ = sqRing_;
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ringFd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(sqRing_);
+    auto* cq = static_cast<uint8_t*>(cqRing_);
+    sqHead_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sqFlags_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.flags);
+    sqArray_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    cqHead_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+    sqLocalTail_ = *sqTail_;
+
+    return true;
+}
+
+bool UringTransport::setupBuffers() {
+    // Receive slots hold the recvmsg_out header, the source address and the payload
+    receiveSlotSize_ = (sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in6) + bufferSize_ + 63) & ~size_t(63);
+    receiveAreaSize_ = receiveSlotSize_ * RECEIVE_BUFFERS;
+    bufferRingSize_ = sizeof(io_uring_buf) * RECEIVE_BUFFERS;
+    sendAreaSize_ = static_cast<size_t>(bufferSize_) * SEND_BUFFERS;
+
+    receiveArea_ = static_cast<uint8_t*>(mapAnonymous(receiveAreaSize_));
+    bufferRing_ = mapAnonymous(bufferRingSize_);
+    sendArea_ = static_cast<uint8_t*>(mapAnonymous(sendAreaSize_));
+    if (!receiveArea_ || !bufferRing_ || !sendArea_) {
+        std::cerr << "Failed to map io_uring buffers" << std::endl;
+        return false;
+    }
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+    registration.ring_entries = RECEIVE_BUFFERS;
+    registration.bgid = BUFFER_GROUP;
+    if (uringRegister(ringFd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        std::cerr << "Failed to register provided buffer ring: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Index entries directly: the uapi flex-array macro misplaces bufs[] under C++
+    auto* ring = static_cast<io_uring_buf_ring*>(bufferRing_);
+    auto* entries = static_cast<io_uring_buf*>(bufferRing_);
+    for (uint32_t i = 0; i < RECEIVE_BUFFERS; ++i) {
+        entries[i].addr = reinterpret_cast<uint64_t>(receiveArea_ + i * receiveSlotSize_);
+        entries[i].len = static_cast<uint32_t>(receiveSlotSize_);
+        entries[i].bid = static_cast<uint16_t>(i);
+    }
+    bufferRingTail_ = static_cast<uint16_t>(RECEIVE_BUFFERS);
+    __atomic_store_n(&ring->tail, bufferRingTail_, __ATOMIC_RELEASE);
+
+    std::vector<iovec> sendVectors(SEND_BUFFERS);
+    for (uint32_t i = 0; i < SEND_BUFFERS; ++i) {
+        sendVectors[i].iov_base = sendArea_ + static_cast<size_t>(i) * bufferSize_;
+        sendVectors[i].iov_len = bufferSize_;
+    }
+    if (uringRegister(ringFd_, IORING_REGISTER_BUFFERS, sendVectors.data(), SEND_BUFFERS) < 0) {
+        std::cerr << "Failed to register send buffers: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    freeSendBuffers_.clear();
+    for (uint32_t i = SEND_BUFFERS; i > 0; --i) {
+        freeSendBuffers_.push_back(static_cast<uint16_t>(i - 1));
+    }
+    sendEndpoints_.assign(SEND_BUFFERS, Endpoint());
+    readyDatagrams_.clear();
+    readyDatagrams_.reserve(RECEIVE_BUFFERS);
+    readyIndex_ = 0;
+    heldBuffers_.clear();
+    heldBuffers_.reserve(RECEIVE_BUFFERS);
+
+    return true;
+}
+
+void UringTransport::close() {
+    // Ring teardown is asynchronous, so the kernel could still be writing into
+    // the receive slots after close(); quiesce it while the memory is mapped
+    if (ringFd_ >= 0) {
+        if (sqes_) {
+            cancelPending();
+        }
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+    if (sqes_) munmap(sqes_, sqesSize_);
+    if (sqRing_) munmap(sqRing_, sqRingSize_);
+    if (bufferRing_) munmap(bufferRing_, bufferRingSize_);
+    if (receiveArea_) munmap(receiveArea_, receiveAreaSize_);
+    if (sendArea_) munmap(sendArea_, sendAreaSize_);
+
+    sqes_ = sqRing_ = cqRing_ = bufferRing_ = nullptr;
+    receiveArea_ = sendArea_ = nullptr;
+    receiveArmed_ = false;
+    pendingSubmissions_ = 0;
+    readyDatagrams_.clear();
+    readyIndex_ = 0;
+    heldBuffers_.clear();
+    freeSendBuffers_.clear();
+    sendEndpoints_.clear();
+}
+
+void UringTransport::cancelPending() {
+    auto* sqe = static_cast<io_uring_sqe*>(getSubmissionEntry());
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data = CANCEL_TAG;
+    }
+
+    // The multishot receive ends with its cancellation; zero-copy sends still
+    // post their notification once the kernel lets go of the slot
+    for (int attempt = 0; attempt < CANCEL_WAIT_ATTEMPTS; ++attempt) {
+        submit();
+        reapCompletions();
+        if (!receiveArmed_ && freeSendBuffers_.size() == sendEndpoints_.size()) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cerr << "io_uring requests still pending at close" << std::endl;
+}
+
+void* UringTransport::getSubmissionEntry() {
+    uint32_t entries = *sqMask_ + 1;
+    if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries) {
+        submit();
+        if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries) {
+            return nullptr;
+        }
+    }
+
+    uint32_t index = sqLocalTail_ & *sqMask_;
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    ++pendingSubmissions_;
+
+    auto* sqe = &static_cast<io_uring_sqe*>(sqes_)[index];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    return sqe;
+}
+
+int UringTransport::submit() {
+    bool needsTaskRun = (__atomic_load_n(sqFlags_, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN) != 0;
+    if (pendingSubmissions_ == 0 && !needsTaskRun) return 0;
+
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    int submitted = uringEnter(ringFd_, pendingSubmissions_, 0, needsTaskRun ? IORING_ENTER_GETEVENTS : 0);
+    if (submitted > 0) {
+        pendingSubmissions_ -= std::min<uint32_t>(pendingSubmissions_, static_cast<uint32_t>(submitted));
+    }
+    return submitted;
+}
+
+bool UringTransport::armReceive() {
+    auto* header = reinterpret_cast<msghdr*>(receiveHeader_);
+    std::memset(header, 0, sizeof(msghdr));
+    header->msg_namelen = sizeof(sockaddr_in6);
+
+    auto* sqe = static_cast<io_uring_sqe*>(getSubmissionEntry());
+    if (!sqe) return false;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket_;
+    sqe->addr = reinterpret_cast<uint64_t>(header);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = RECEIVE_TAG;
+
+    receiveArmed_ = true;
+    return true;
+}
+
+void UringTransport::recycleBuffers() {
+    if (heldBuffers_.empty()) return;
+
+    auto* ring = static_cast<io_uring_buf_ring*>(bufferRing_);
+    auto* entries = static_cast<io_uring_buf*>(bufferRing_);
+    const uint16_t mask = static_cast<uint16_t>(RECEIVE_BUFFERS - 1);
+    for (uint16_t bid : heldBuffers_) {
+        io_uring_buf& entry = entries[bufferRingTail_ & mask];
+        entry.addr = reinterpret_cast<uint64_t>(receiveArea_ + bid * receiveSlotSize_);
+        entry.len = static_cast<uint32_t>(receiveSlotSize_);
+        entry.bid = bid;
+        ++bufferRingTail_;
+    }
+    __atomic_store_n(&ring->tail, bufferRingTail_, __ATOMIC_RELEASE);
+    heldBuffers_.clear();
+}
+
+void UringTransport::reapCompletions() {
+    uint32_t head = *cqHead_;
+    uint32_t tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    auto* cqes = static_cast<io_uring_cqe*>(cqes_);
+
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes[head & *cqMask_];
+
+        if (cqe.user_data == CANCEL_TAG) continue;
+        if (cqe.user_data != RECEIVE_TAG) {
+            handleSendCompletion(cqe.user_data, cqe.flags);
+            continue;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            receiveArmed_ = false; // Multishot ended (e.g. -ENOBUFS); re-armed below
+        }
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) continue;
+
+        uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        uint8_t* slot = receiveArea_ + bid * receiveSlotSize_;
+        const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(slot);
+
+        if (cqe.res < 0 || (out->flags & MSG_TRUNC)) {
+            heldBuffers_.push_back(bid);
+            continue;
+        }
+
+        Datagram datagram{};
+        const uint8_t* name = slot + sizeof(io_uring_recvmsg_out);
+        datagram.endpoint.length = std::min<uint32_t>(out->namelen, sizeof(datagram.endpoint.address));
+        std::memcpy(datagram.endpoint.address, name, datagram.endpoint.length);
+        datagram.data = slot + sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in6);
+        datagram.size = out->payloadlen;
+        datagram.capacity = bufferSize_;
+        readyDatagrams_.push_back(datagram);
+    }
+
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void UringTransport::handleSendCompletion(uint64_t userData, uint32_t flags) {
+    // Zero-copy sends post a second notification CQE once the kernel drops its
+    // reference; the slot is only reusable after that
+    if ((flags & IORING_CQE_F_NOTIF) || !(flags & IORING_CQE_F_MORE)) {
+        freeSendBuffers_.push_back(static_cast<uint16_t>(userData));
+    }
+}
+
+int UringTransport::receiveBatch(Datagram* datagrams, size_t count) {
+    if (ringFd_ < 0) return -1;
+
+    // Buffers from the previous batch are no longer referenced by the caller
+    recycleBuffers();
+    if (readyIndex_ == readyDatagrams_.size()) {
+        readyDatagrams_.clear();
+        readyIndex_ = 0;
+        submit();
+        reapCompletions();
+    }
+    if (!receiveArmed_ && armReceive()) {
+        submit();
+    }
+
+    size_t produced = 0;
+    while (produced < count && readyIndex_ < readyDatagrams_.size()) {
+        const Datagram& ready = readyDatagrams_[readyIndex_++];
+        datagrams[produced++] = ready;
+        heldBuffers_.push_back(static_cast<uint16_t>((ready.data - receiveArea_) / receiveSlotSize_));
+    }
+    return static_cast<int>(produced);
+}
+
+int UringTransport::sendBatch(const Datagram* datagrams, size_t count) {
+    if (ringFd_ < 0) return -1;
+
+    // A datagram too large for a registered slot is skipped on its own; the
+    // caller takes back whatever is left once the slots run out
+    size_t queued = 0;
+    for (; queued < count; ++queued) {
+        const Datagram& datagram = datagrams[queued];
+        if (datagram.size > bufferSize_) {
+            std::cerr << "Dropping datagram of " << datagram.size << " bytes to "
+                      << UdpSocket::toString(datagram.endpoint) << ", larger than the io_uring send slot"
+                      << std::endl;
+            droppedDatagrams_++;
+            continue;
+        }
+
+        if (freeSendBuffers_.empty()) {
+            submit();
+            reapCompletions();
+            if (freeSendBuffers_.empty()) break;
+        }
+
+        auto* sqe = static_cast<io_uring_sqe*>(getSubmissionEntry());
+        if (!sqe) break;
+
+        uint16_t slot = freeSendBuffers_.back();
+        freeSendBuffers_.pop_back();
+        uint8_t* buffer = sendArea_ + static_cast<size_t>(slot) * bufferSize_;
+        std::memcpy(buffer, datagram.data, datagram.size);
+        sendEndpoints_[slot] = datagram.endpoint;
+
+        sqe->opcode = IORING_OP_SEND_ZC;
+        sqe->fd = socket_;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = datagram.size;
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+        sqe->buf_index = slot;
+        sqe->addr2 = reinterpret_cast<uint64_t>(sendEndpoints_[slot].address);
+        sqe->addr_len = static_cast<uint16_t>(sendEndpoints_[slot].length);
+        sqe->user_data = slot;
+    }
+
+    submit();
+    return static_cast<int>(queued);
+}
+
+#else
+
+bool UringTransport::open(int, uint32_t) { return false; }
+void UringTransport::close() { ringFd_ = -1; }
+int UringTransport::receiveBatch(Datagram*, size_t) { return -1; }
+int UringTransport::sendBatch(const Datagram*, size_t) { return -1; }
+
+#endif
+
+} // namespace BarrenEngine
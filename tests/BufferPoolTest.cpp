@@ -0,0 +1,98 @@
+#include "buffer/PacketBuffer.hpp"
+#include "Check.hpp"
+#include <mutex>
+#include <thread>
+
+using namespace BarrenEngine;
+
+namespace {
+
+constexpr int THREADS = 4;
+constexpr int ROUNDS = 20000;
+
+struct Mailbox {
+    std::mutex mutex;
+    std::vector<PacketBuffer> buffers;
+};
+
+// Every thread fills buffers and posts them to the next one, which checks
+// and releases them, so blocks keep moving from one thread's cache to
+// another's through the shared list
+void testBlocksCrossThreads() {
+    constexpr size_t BATCH = 100;
+    BufferPool pool(1000);
+    std::vector<Mailbox> mailboxes(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&pool, &mailboxes, t] {
+            std::vector<PacketBuffer> batch, received;
+            for (int i = 0; i < ROUNDS; ++i) {
+                PacketBuffer buffer = pool.acquire(1000);
+                CHECK(buffer.append(1000) != nullptr);
+                buffer.data()[0] = static_cast<uint8_t>(t);
+                batch.push_back(std::move(buffer));
+                if (batch.size() < BATCH) continue;
+
+                Mailbox& next = mailboxes[(t + 1) % THREADS];
+                {
+                    std::lock_guard<std::mutex> lock(next.mutex);
+                    for (PacketBuffer& posted : batch) {
+                        next.buffers.push_back(std::move(posted));
+                    }
+                }
+                batch.clear();
+
+                {
+                    std::lock_guard<std::mutex> lock(mailboxes[t].mutex);
+                    received.swap(mailboxes[t].buffers);
+                }
+                for (const PacketBuffer& held : received) {
+                    CHECK(held.data()[0] == (t + THREADS - 1) % THREADS);
+                }
+                received.clear();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (Mailbox& mailbox : mailboxes) {
+        mailbox.buffers.clear();
+    }
+
+    // The workers handed their caches back on exit; only this thread's is left
+    CHECK(pool.getFreeCount() <= pool.getBlockCount());
+    CHECK(pool.getFreeCount() + BufferPool::THREAD_CACHE_BLOCKS >= pool.getBlockCount());
+}
+
+// A pool may go away while a live thread still caches some of its blocks
+void testPoolDiesBeforeCachingThread() {
+    std::atomic<int> stage{0};
+    std::unique_ptr<BufferPool> pool(new BufferPool(500));
+    std::thread worker([&] {
+        { PacketBuffer buffer = pool->acquire(); }
+        stage = 1;
+        while (stage != 2) std::this_thread::yield();
+
+        // A pool built at the dead pool's address starts with an empty cache
+        for (int i = 0; i < 1000; ++i) {
+            PacketBuffer buffer = pool->acquire(100);
+            CHECK(buffer.append(100) != nullptr);
+        }
+    });
+
+    while (stage != 1) std::this_thread::yield();
+    pool.reset();
+    pool.reset(new BufferPool(500));
+    stage = 2;
+    worker.join();
+    CHECK(pool->getFreeCount() <= pool->getBlockCount());
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testBlocksCrossThreads);
+    RUN_TEST(testPoolDiesBeforeCachingThread);
+    return Test::failures() == 0 ? 0 : 1;
+}
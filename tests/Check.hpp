@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+
+namespace BarrenEngine {
+namespace Test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        failures()++;
+    }
+}
+
+// Runs one test function and reports it by name
+template <typename Test>
+void run(const char* name, Test test) {
+    int before = failures();
+    test();
+    std::cout << (failures() == before ? "[ OK ] " : "[FAIL] ") << name << std::endl;
+}
+
+} // namespace Test
+} // namespace BarrenEngine
+
+#define CHECK(condition) ::BarrenEngine::Test::check((condition), #condition, __FILE__, __LINE__)
+#define RUN_TEST(test) ::BarrenEngine::Test::run(#test, test)
@@ -0,0 +1,155 @@
+#include "protocol/FecCodec.hpp"
+#include "NetworkManager.hpp"
+#include "Check.hpp"
+#include "LossyProxy.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <set>
+
+using namespace BarrenEngine;
+
+namespace {
+
+// Encodes groups of random packets, drops up to M members of each and
+// checks that exactly the lost data packets come back intact
+void testRecoversUpToParityCountLosses() {
+    BufferPool pool(2048);
+    std::mt19937 rng(1);
+    size_t recovered = 0;
+
+    for (int trial = 0; trial < 300; ++trial) {
+        uint8_t dataCount = static_cast<uint8_t>(1 + rng() % FecEncoder::MAX_DATA_PACKETS);
+        uint8_t parityCount = static_cast<uint8_t>(1 + rng() % FecEncoder::MAX_PARITY_PACKETS);
+        size_t groupSize = dataCount + parityCount;
+        FecEncoder encoder(pool, dataCount, parityCount, 1400);
+        FecDecoder decoder(pool);
+
+        for (int group = 0; group < 3; ++group) {
+            std::vector<WireHeader> headers(groupSize);
+            std::vector<PacketBuffer> payloads(groupSize);
+            for (uint8_t i = 0; i < dataCount; ++i) {
+                WireHeader& header = headers[i];
+                header.reliability = static_cast<uint8_t>(PacketReliability::UNRELIABLE_SEQUENCED);
+                header.sequence = static_cast<uint16_t>(trial * 100 + group * 20 + i);
+                header.channel = 2;
+                header.orderSequence = i;
+
+                // Sizes differ so the shorter symbols are padded
+                size_t size = rng() % 1200;
+                payloads[i] = pool.acquire(size);
+                uint8_t* data = payloads[i].append(size);
+                for (size_t k = 0; k < size; ++k) data[k] = static_cast<uint8_t>(rng());
+                CHECK(encoder.addPacket(header, payloads[i]));
+            }
+            CHECK(encoder.isGroupComplete());
+            for (uint8_t j = 0; j < parityCount; ++j) {
+                encoder.takeParity(j, headers[dataCount + j], payloads[dataCount + j]);
+            }
+
+            // Lose a random subset of at most M packets, deliver the rest in order
+            std::vector<size_t> order(groupSize);
+            for (size_t i = 0; i < groupSize; ++i) order[i] = i;
+            std::shuffle(order.begin(), order.end(), rng);
+            size_t lost = rng() % (parityCount + 1);
+            std::sort(order.begin() + lost, order.end());
+            size_t lostData = static_cast<size_t>(std::count_if(order.begin(), order.begin() + lost,
+                [dataCount](size_t i) { return i < dataCount; }));
+
+            std::vector<PacketBuffer> rebuilt;
+            for (size_t k = lost; k < groupSize; ++k) {
+                size_t i = order[k];
+                decoder.addPacket(headers[i], payloads[i].data(), payloads[i].size(), rebuilt);
+            }
+            CHECK(rebuilt.size() == lostData);
+
+            for (auto& packet : rebuilt) {
+                WireHeader header;
+                size_t headerSize = header.decode(packet.data(), packet.size());
+                CHECK(headerSize > 0);
+                if (headerSize == 0 || header.orderSequence >= dataCount) continue;
+                const PacketBuffer& original = payloads[header.orderSequence];
+                CHECK(header.sequence == headers[header.orderSequence].sequence);
+                CHECK(packet.size() - headerSize == original.size());
+                CHECK(std::equal(original.data(), original.data() + original.size(), packet.data() + headerSize));
+                recovered++;
+            }
+        }
+    }
+    CHECK(recovered > 0);
+}
+
+void testOversizedPacketsGoUnprotected() {
+    BufferPool pool(2048);
+    FecEncoder encoder(pool, 4, 2, 500);
+    WireHeader header;
+    header.reliability = static_cast<uint8_t>(PacketReliability::UNRELIABLE_SEQUENCED);
+    PacketBuffer payload = pool.acquire(1000);
+    payload.append(1000);
+    CHECK(!encoder.addPacket(header, payload));
+    CHECK(!(header.flags & WireHeader::FEC));
+}
+
+// End to end: with 4 + 2 parity, most UNRELIABLE_SEQUENCED packets lost on
+// the way are rebuilt from the rest of their group
+void testRecoversLossOverLoopback() {
+    constexpr uint16_t port = 40500;
+    constexpr uint32_t messageCount = 2000;
+    NetworkConfig config{};
+    config.port = port;
+    config.maxConnections = 16;
+    config.bufferSize = 1500;
+    config.fragmentSize = 1000;
+    config.maxPacketSize = 1400;
+    config.fragmentTimeout = 1000;
+    config.connectionTimeout = 10000;
+    config.fecDataPackets = 4;
+    config.fecParityPackets = 2;
+
+    NetworkManager server, client;
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    Test::LossyProxy proxy(port + 1, port, 0.1);
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", port + 1));
+
+    std::set<uint32_t> delivered;
+    auto drain = [&] {
+        NetworkMessage message;
+        while (server.receive(message)) {
+            uint32_t value = 0;
+            std::memcpy(&value, message.data.data(), sizeof(value));
+            delivered.insert(value);
+        }
+    };
+
+    for (uint32_t i = 0; i < messageCount; ++i) {
+        NetworkMessage message{};
+        message.data.resize(200);
+        std::memcpy(message.data.data(), &i, sizeof(i));
+        message.reliability = PacketReliability::UNRELIABLE_SEQUENCED;
+        message.clientId = 0;
+        CHECK(client.send(message) > 0);
+        if (i % 50 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        drain();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    drain();
+
+    // Without FEC about a tenth would be missing
+    CHECK(proxy.getDropped() > messageCount / 20);
+    CHECK(delivered.size() >= messageCount * 97 / 100);
+    client.shutdown();
+    server.shutdown();
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testRecoversUpToParityCountLosses);
+    RUN_TEST(testOversizedPacketsGoUnprotected);
+    RUN_TEST(testRecoversLossOverLoopback);
+    return Test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#include "protocol/FragmentAssembler.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <random>
+
+using namespace BarrenEngine;
+
+namespace {
+
+constexpr uint32_t FRAGMENT_SIZE = 1000;
+
+std::vector<uint8_t> makeMessage(size_t size) {
+    std::vector<uint8_t> message(size);
+    for (size_t i = 0; i < size; ++i) {
+        message[i] = static_cast<uint8_t>(i * 31);
+    }
+    return message;
+}
+
+void testReassemblesShuffledFragments() {
+    BufferPool pool(1500);
+    FragmentAssembler assembler(pool, FRAGMENT_SIZE, 0, 100);
+    auto message = makeMessage(4 * 1024 * 1024 + 123);
+    uint32_t total = static_cast<uint32_t>((message.size() + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE);
+
+    std::vector<uint32_t> order(total);
+    for (uint32_t i = 0; i < total; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+    auto now = std::chrono::steady_clock::now();
+    PacketBuffer output;
+    FragmentAssembler::Result result = FragmentAssembler::Result::REJECTED;
+    size_t duplicates = 0;
+    for (size_t k = 0; k < order.size(); ++k) {
+        uint32_t index = order[k];
+        size_t length = std::min<size_t>(FRAGMENT_SIZE, message.size() - index * FRAGMENT_SIZE);
+        const uint8_t* fragment = message.data() + index * FRAGMENT_SIZE;
+        result = assembler.addFragment(7, 1, index, total, fragment, length, output, now);
+        if (k % 10 == 0 && k + 1 < order.size() &&
+            assembler.addFragment(7, 1, index, total, fragment, length, output, now) ==
+                FragmentAssembler::Result::DUPLICATE) {
+            duplicates++;
+        }
+    }
+
+    CHECK(result == FragmentAssembler::Result::COMPLETE);
+    CHECK(output.size() == message.size());
+    CHECK(std::equal(message.begin(), message.end(), output.data()));
+    CHECK(duplicates == (order.size() - 1 + 9) / 10);
+    CHECK(assembler.getPendingCount() == 0);
+    CHECK(assembler.getPendingBytes() == 0);
+}
+
+void testRejectsInconsistentFragments() {
+    BufferPool pool(1500);
+    FragmentAssembler assembler(pool, FRAGMENT_SIZE, 64 * 1024, 100);
+    auto message = makeMessage(FRAGMENT_SIZE);
+    auto now = std::chrono::steady_clock::now();
+    PacketBuffer output;
+
+    // Over the message size limit, an index past the end, and a short fragment that is not the last
+    CHECK(assembler.addFragment(7, 1, 0, 100, message.data(), FRAGMENT_SIZE, output, now) ==
+          FragmentAssembler::Result::REJECTED);
+    CHECK(assembler.addFragment(7, 2, 3, 3, message.data(), FRAGMENT_SIZE, output, now) ==
+          FragmentAssembler::Result::REJECTED);
+    CHECK(assembler.addFragment(7, 3, 0, 3, message.data(), 10, output, now) ==
+          FragmentAssembler::Result::REJECTED);
+    CHECK(assembler.getPendingCount() == 0);
+}
+
+void testExpiresIncompleteMessages() {
+    BufferPool pool(1500);
+    FragmentAssembler assembler(pool, FRAGMENT_SIZE, 0, 100);
+    auto message = makeMessage(FRAGMENT_SIZE);
+    auto now = std::chrono::steady_clock::now();
+    PacketBuffer output;
+
+    CHECK(assembler.addFragment(7, 1, 0, 3, message.data(), FRAGMENT_SIZE, output, now) ==
+          FragmentAssembler::Result::INCOMPLETE);
+    CHECK(assembler.getNextExpiry() == now + std::chrono::milliseconds(100));
+
+    assembler.expire(now + std::chrono::milliseconds(50));
+    CHECK(assembler.getPendingCount() == 1);
+    assembler.expire(now + std::chrono::milliseconds(150));
+    CHECK(assembler.getPendingCount() == 0);
+    CHECK(assembler.getPendingBytes() == 0);
+    CHECK(assembler.getExpiredCount() == 1);
+    CHECK(assembler.getNextExpiry() == std::chrono::steady_clock::time_point::max());
+}
+
+void testCapsPendingBytes() {
+    // 1 MB messages against a 4 MB budget: a flood of first fragments
+    // reserves four messages and the rest are turned away
+    BufferPool pool(1500);
+    FragmentAssembler assembler(pool, FRAGMENT_SIZE, 1 << 20, 100, 4 << 20);
+    auto message = makeMessage(FRAGMENT_SIZE);
+    auto now = std::chrono::steady_clock::now();
+    PacketBuffer output;
+
+    size_t accepted = 0;
+    for (uint32_t id = 0; id < 100; ++id) {
+        if (assembler.addFragment(7, id, 0, 1000, message.data(), FRAGMENT_SIZE, output, now) ==
+            FragmentAssembler::Result::INCOMPLETE) {
+            accepted++;
+        }
+    }
+    CHECK(accepted == 4);
+    CHECK(assembler.getPendingBytes() <= (4u << 20));
+
+    // Expiry frees the budget for new messages
+    assembler.expire(now + std::chrono::milliseconds(200));
+    CHECK(assembler.getPendingBytes() == 0);
+    FragmentAssembler::Result result = FragmentAssembler::Result::REJECTED;
+    for (uint32_t i = 0; i < 3; ++i) {
+        result = assembler.addFragment(8, 1, i, 3, message.data(), i == 2 ? 10 : FRAGMENT_SIZE, output, now);
+    }
+    CHECK(result == FragmentAssembler::Result::COMPLETE);
+    CHECK(output.size() == 2 * FRAGMENT_SIZE + 10);
+    CHECK(assembler.getPendingBytes() == 0);
+}
+
+void testCapsPendingMessages() {
+    BufferPool pool(1500);
+    FragmentAssembler assembler(pool, FRAGMENT_SIZE, 0, 100);
+    auto message = makeMessage(FRAGMENT_SIZE);
+    auto now = std::chrono::steady_clock::now();
+    PacketBuffer output;
+
+    size_t accepted = 0;
+    for (uint32_t id = 0; id < FragmentAssembler::MAX_PENDING_MESSAGES + 10; ++id) {
+        if (assembler.addFragment(7, id, 0, 2, message.data(), FRAGMENT_SIZE, output, now) ==
+            FragmentAssembler::Result::INCOMPLETE) {
+            accepted++;
+        }
+    }
+    CHECK(accepted == FragmentAssembler::MAX_PENDING_MESSAGES);
+    CHECK(assembler.getPendingCount() == FragmentAssembler::MAX_PENDING_MESSAGES);
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testReassemblesShuffledFragments);
+    RUN_TEST(testRejectsInconsistentFragments);
+    RUN_TEST(testExpiresIncompleteMessages);
+    RUN_TEST(testCapsPendingBytes);
+    RUN_TEST(testCapsPendingMessages);
+    return Test::failures() == 0 ? 0 : 1;
+}
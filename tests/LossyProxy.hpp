@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace BarrenEngine {
+namespace Test {
+
+// Relays datagrams between one client and a server on 127.0.0.1, dropping
+// each one with the given probability in either direction
+class LossyProxy {
+public:
+    LossyProxy(uint16_t port, uint16_t serverPort, double loss, uint32_t seed = 7)
+        : loss_(loss), rng_(seed), stop_(false), forwarded_(0), dropped_(0) {
+        clientSide_ = socket(AF_INET, SOCK_DGRAM, 0);
+        serverSide_ = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        bind(clientSide_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        server_ = address;
+        server_.sin_port = htons(serverPort);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~LossyProxy() {
+        stop_ = true;
+        thread_.join();
+        close(clientSide_);
+        close(serverSide_);
+    }
+
+    size_t getForwarded() const { return forwarded_; }
+    size_t getDropped() const { return dropped_; }
+
+private:
+    void run() {
+        sockaddr_in client{};
+        bool hasClient = false;
+        uint8_t buffer[65536];
+        while (!stop_) {
+            pollfd fds[2] = { { clientSide_, POLLIN, 0 }, { serverSide_, POLLIN, 0 } };
+            if (poll(fds, 2, 20) <= 0) continue;
+
+            if (fds[0].revents & POLLIN) {
+                socklen_t length = sizeof(client);
+                ssize_t size = recvfrom(clientSide_, buffer, sizeof(buffer), 0,
+                                        reinterpret_cast<sockaddr*>(&client), &length);
+                hasClient = true;
+                if (size > 0 && keep()) {
+                    sendto(serverSide_, buffer, size, 0, reinterpret_cast<sockaddr*>(&server_), sizeof(server_));
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                ssize_t size = recv(serverSide_, buffer, sizeof(buffer), 0);
+                if (size > 0 && hasClient && keep()) {
+                    sendto(clientSide_, buffer, size, 0, reinterpret_cast<sockaddr*>(&client), sizeof(client));
+                }
+            }
+        }
+    }
+
+    bool keep() {
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < loss_) {
+            dropped_++;
+            return false;
+        }
+        forwarded_++;
+        return true;
+    }
+
+    double loss_;
+    std::mt19937 rng_;
+    int clientSide_;
+    int serverSide_;
+    sockaddr_in server_;
+    std::atomic<bool> stop_;
+    std::atomic<size_t> forwarded_;
+    std::atomic<size_t> dropped_;
+    std::thread thread_;
+};
+
+} // namespace Test
+} // namespace BarrenEngine
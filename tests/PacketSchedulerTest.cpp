@@ -0,0 +1,238 @@
+#include "PacketPriority.hpp"
+#include "Check.hpp"
+#include <cstdint>
+#include <map>
+#include <random>
+#include <thread>
+
+using namespace BarrenEngine;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::milliseconds;
+
+PacketMetadata makeMetadata(PacketPriority priority, QoSLevel qos, Clock::time_point deadline,
+                            uint32_t clientId = 0, uint32_t sequence = 0) {
+    PacketMetadata metadata{};
+    metadata.priority = priority;
+    metadata.qos = qos;
+    metadata.deadline = deadline;
+    metadata.clientId = clientId;
+    metadata.sequenceNumber = sequence;
+    return metadata;
+}
+
+void testStrictPriorityAndFifoWithinLevel() {
+    PacketScheduler scheduler(100000);
+    std::mt19937 rng(1);
+    auto deadline = Clock::now() + std::chrono::seconds(60);
+    for (uint32_t i = 0; i < 20000; ++i) {
+        auto priority = static_cast<PacketPriority>(rng() % 5);
+        CHECK(scheduler.enqueuePacket(std::vector<uint8_t>(10, static_cast<uint8_t>(i)),
+                                      makeMetadata(priority, QoSLevel::BALANCED, deadline, 0, i)));
+    }
+
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    int lastPriority = 0;
+    std::map<int, int64_t> lastSequence;
+    size_t count = 0;
+    while (scheduler.dequeuePacket(data, metadata)) {
+        int priority = static_cast<int>(metadata.priority);
+        CHECK(priority >= lastPriority);
+        CHECK(lastSequence.count(priority) == 0 || metadata.sequenceNumber > lastSequence[priority]);
+        CHECK(data.size() == 10 && data[0] == static_cast<uint8_t>(metadata.sequenceNumber));
+        lastPriority = priority;
+        lastSequence[priority] = metadata.sequenceNumber;
+        count++;
+    }
+    CHECK(count == 20000);
+    CHECK(scheduler.getQueueSize() == 0);
+}
+
+void testRejectsBeyondCapacity() {
+    PacketScheduler scheduler(3);
+    auto metadata = makeMetadata(PacketPriority::MEDIUM, QoSLevel::BALANCED, Clock::now() + std::chrono::seconds(60));
+    size_t accepted = 0;
+    for (int i = 0; i < 5; ++i) {
+        accepted += scheduler.enqueuePacket(std::vector<uint8_t>(1), metadata) ? 1 : 0;
+    }
+    CHECK(accepted == 3);
+}
+
+void testRoundRobinSharesLevelByWeight() {
+    // One client with a deep backlog against 50 light ones and one at weight 3
+    PacketScheduler scheduler(200000);
+    scheduler.setClientWeight(7, 3);
+    std::mt19937 rng(1);
+    auto deadline = Clock::now() + std::chrono::seconds(60);
+    for (uint32_t i = 0; i < 5000; ++i) {
+        scheduler.enqueuePacket(std::vector<uint8_t>(1200),
+                                makeMetadata(PacketPriority::LOW, QoSLevel::BALANCED, deadline, 1000, i));
+    }
+    for (uint32_t client = 0; client < 50; ++client) {
+        for (uint32_t i = 0; i < 40; ++i) {
+            scheduler.enqueuePacket(std::vector<uint8_t>(200 + rng() % 1000),
+                                    makeMetadata(PacketPriority::LOW, QoSLevel::BALANCED, deadline, client, i));
+        }
+    }
+
+    std::map<uint32_t, size_t> bytes;
+    std::map<uint32_t, uint32_t> lastSequence;
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    for (int i = 0; i < 1000 && scheduler.dequeuePacket(data, metadata); ++i) {
+        bytes[metadata.clientId] += data.size();
+        CHECK(lastSequence.count(metadata.clientId) == 0 || metadata.sequenceNumber > lastSequence[metadata.clientId]);
+        lastSequence[metadata.clientId] = metadata.sequenceNumber;
+    }
+
+    // Every client sends its quantum per round whatever its backlog; weight 3 sends three
+    size_t fewest = SIZE_MAX, most = 0;
+    for (auto& pair : bytes) {
+        if (pair.first == 1000 || pair.first == 7) continue;
+        fewest = std::min(fewest, pair.second);
+        most = std::max(most, pair.second);
+    }
+    CHECK(bytes.size() == 51);
+    CHECK(most - fewest <= 2 * 1500);
+    CHECK(bytes[1000] <= most + 1500);
+    CHECK(bytes[7] >= 2 * fewest);
+
+    // Removing the heavy client takes its backlog with it
+    size_t before = scheduler.getQueueSize();
+    scheduler.removeClient(1000);
+    CHECK(scheduler.getQueueSize() < before - 4000);
+    while (scheduler.dequeuePacket(data, metadata)) {
+        CHECK(metadata.clientId != 1000);
+    }
+    CHECK(scheduler.getQueueSize() == 0);
+}
+
+void testDeadlinesGoEarliestFirst() {
+    PacketScheduler scheduler(10000);
+    std::mt19937 rng(3);
+    auto now = Clock::now();
+    for (uint32_t i = 0; i < 1000; ++i) {
+        scheduler.enqueuePacket(std::vector<uint8_t>(100),
+                                makeMetadata(PacketPriority::HIGH, QoSLevel::ULTRA_LOW_LATENCY,
+                                             now + Milliseconds(1000 + rng() % 5000), rng() % 10, i));
+    }
+    for (uint32_t i = 0; i < 100; ++i) {
+        scheduler.enqueuePacket(std::vector<uint8_t>(100),
+                                makeMetadata(PacketPriority::HIGH, QoSLevel::BALANCED, now + Milliseconds(60000), 1));
+    }
+    scheduler.enqueuePacket(std::vector<uint8_t>(100),
+                            makeMetadata(PacketPriority::CRITICAL, QoSLevel::BALANCED, now + Milliseconds(60000)));
+
+    // A higher level still comes first; within the level the deadline heap goes ahead of the round
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    CHECK(scheduler.dequeuePacket(data, metadata) && metadata.priority == PacketPriority::CRITICAL);
+    Clock::time_point last{};
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(scheduler.dequeuePacket(data, metadata));
+        CHECK(metadata.qos == QoSLevel::ULTRA_LOW_LATENCY);
+        CHECK(metadata.deadline >= last);
+        last = metadata.deadline;
+    }
+    size_t rest = 0;
+    while (scheduler.dequeuePacket(data, metadata)) {
+        CHECK(metadata.qos == QoSLevel::BALANCED);
+        rest++;
+    }
+    CHECK(rest == 100);
+}
+
+void testExpiredPacketsAreDropped() {
+    PacketScheduler scheduler(10000);
+    auto now = Clock::now();
+    for (uint32_t i = 0; i < 2000; ++i) {
+        QoSLevel qos = i % 4 == 0 ? QoSLevel::ULTRA_LOW_LATENCY : QoSLevel::BALANCED;
+        scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                                makeMetadata(PacketPriority::MEDIUM, qos, now + Milliseconds(i % 2 ? 20 : 60000),
+                                             i % 7, i));
+    }
+    std::this_thread::sleep_for(Milliseconds(150));
+
+    // The first dequeue sweeps every expired packet, not only those at the front
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    CHECK(scheduler.dequeuePacket(data, metadata));
+    CHECK(scheduler.getQueueSize() == 999);
+    CHECK(scheduler.getExpiredPackets() == 1000);
+    CHECK(scheduler.getExpiredPackets(QoSLevel::BALANCED) == 1000);
+    while (scheduler.dequeuePacket(data, metadata)) {
+        CHECK(metadata.deadline >= Clock::now());
+    }
+}
+
+void testThrottledClassLetsOthersGo() {
+    // Two classes of the level are capped at 1000 B/s, so each sends one
+    // packet from its burst and then waits; the uncapped class keeps going
+    PacketScheduler scheduler(10000);
+    scheduler.setQoSBandwidth(QoSLevel::HIGH_THROUGHPUT, 1000, 1500);
+    scheduler.setQoSBandwidth(QoSLevel::ULTRA_LOW_LATENCY, 1000, 1500);
+    auto deadline = Clock::now() + std::chrono::seconds(60);
+    for (uint32_t i = 0; i < 10; ++i) {
+        scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                                makeMetadata(PacketPriority::MEDIUM, QoSLevel::HIGH_THROUGHPUT, deadline, 1, i));
+        scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                                makeMetadata(PacketPriority::MEDIUM, QoSLevel::ULTRA_LOW_LATENCY, deadline, 3, i));
+        scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                                makeMetadata(PacketPriority::MEDIUM, QoSLevel::BALANCED, deadline, 2, i));
+    }
+
+    std::map<uint32_t, size_t> sent;
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    Clock::duration wait;
+    PacketScheduler::DequeueResult result;
+    while ((result = scheduler.dequeuePacket(data, metadata, wait)) == PacketScheduler::DequeueResult::PACKET) {
+        sent[metadata.clientId]++;
+    }
+    CHECK(result == PacketScheduler::DequeueResult::THROTTLED);
+    CHECK(wait > Clock::duration::zero());
+    CHECK(sent[1] == 1);
+    CHECK(sent[2] == 10);
+    CHECK(sent[3] == 1);
+}
+
+void testLinkBucketShapesEverything() {
+    PacketScheduler scheduler(1000);
+    scheduler.setMaxBandwidth(100000);
+    scheduler.setBurstSize(5000);
+    auto deadline = Clock::now() + std::chrono::seconds(60);
+    for (uint32_t i = 0; i < 20; ++i) {
+        scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                                makeMetadata(PacketPriority::LOW, QoSLevel::BALANCED, deadline, i % 3, i));
+    }
+    scheduler.enqueuePacket(std::vector<uint8_t>(1000),
+                            makeMetadata(PacketPriority::CRITICAL, QoSLevel::BALANCED, deadline));
+
+    // The CRITICAL packet always passes and takes 1000 of the 5000-byte burst,
+    // leaving room for four LOW packets: five are sent in all
+    std::vector<uint8_t> data;
+    PacketMetadata metadata;
+    Clock::duration wait;
+    size_t sent = 0;
+    while (scheduler.dequeuePacket(data, metadata, wait) == PacketScheduler::DequeueResult::PACKET) {
+        sent++;
+    }
+    CHECK(sent == 5);
+    CHECK(wait > Clock::duration::zero() && wait <= Milliseconds(20));
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testStrictPriorityAndFifoWithinLevel);
+    RUN_TEST(testRejectsBeyondCapacity);
+    RUN_TEST(testRoundRobinSharesLevelByWeight);
+    RUN_TEST(testDeadlinesGoEarliestFirst);
+    RUN_TEST(testExpiredPacketsAreDropped);
+    RUN_TEST(testThrottledClassLetsOthersGo);
+    RUN_TEST(testLinkBucketShapesEverything);
+    return Test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "transport/Reactor.hpp"
+#include "NetworkManager.hpp"
+#include "Check.hpp"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace BarrenEngine;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Producers publish work and call wakeup() while the loop waits with no
+// timer armed, so every piece of work must be seen through a wakeup alone
+void testWakeupsAreNeverLost() {
+    int socketHandle = socket(AF_INET, SOCK_DGRAM, 0);
+    Reactor reactor;
+    CHECK(reactor.open(socketHandle));
+
+    constexpr int producers = 4;
+    constexpr int rounds = 50000;
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> seen{0};
+    std::atomic<bool> stop{false};
+    std::atomic<int> stalls{0};
+
+    std::thread loop([&] {
+        while (!stop) {
+            reactor.wait();
+            seen = published.load();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < rounds && stalls == 0; ++i) {
+                uint64_t value = ++published;
+                reactor.wakeup();
+                auto deadline = Clock::now() + std::chrono::seconds(1);
+                while (seen < value) {
+                    if (Clock::now() > deadline) {
+                        stalls++;
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    CHECK(stalls == 0);
+
+    stop = true;
+    reactor.wakeup();
+    loop.join();
+    reactor.close();
+    close(socketHandle);
+}
+
+// Concurrent send() calls against an idle shard: with no keep-alive and no
+// traffic the shard sleeps without a deadline, so only wakeups get the
+// messages out
+void testConcurrentSendsReachIdleShard() {
+    NetworkConfig config{};
+    config.port = 40600;
+    config.maxConnections = 16;
+    config.bufferSize = 1500;
+    config.fragmentSize = 1000;
+    config.maxPacketSize = 1400;
+    config.fragmentTimeout = 1000;
+    config.keepAliveInterval = 0;
+    NetworkManager server, client;
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40600));
+
+    constexpr int senders = 4;
+    constexpr int bursts = 50;
+    std::atomic<int> received{0};
+    server.setMessageViewCallback([&](const NetworkMessageView&) { received++; });
+
+    for (int burst = 0; burst < bursts; ++burst) {
+        // Let the shard go idle, then send from several threads at once
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int expected = received + senders;
+        std::vector<std::thread> threads;
+        for (int s = 0; s < senders; ++s) {
+            threads.emplace_back([&] {
+                NetworkMessage message{};
+                message.data = { 1, 2, 3 };
+                message.reliability = PacketReliability::UNRELIABLE;
+                message.clientId = 0;
+                CHECK(client.send(message) > 0);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        auto deadline = Clock::now() + std::chrono::milliseconds(200);
+        while (received < expected && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(received == expected);
+        if (received != expected) break;
+    }
+    client.shutdown();
+    server.shutdown();
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testWakeupsAreNeverLost);
+    RUN_TEST(testConcurrentSendsReachIdleShard);
+    return Test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+#include "NetworkManager.hpp"
+#include "Check.hpp"
+#include "LossyProxy.hpp"
+#include <array>
+#include <cstring>
+#include <set>
+
+using namespace BarrenEngine;
+
+namespace {
+
+constexpr double LOSS = 0.1;
+constexpr int MESSAGE_COUNT = 2000;
+constexpr uint8_t CHANNELS = 3;
+
+NetworkConfig makeConfig(uint16_t port) {
+    NetworkConfig config{};
+    config.port = port;
+    config.maxConnections = 16;
+    config.bufferSize = 1500;
+    config.fragmentSize = 1000;
+    config.maxPacketSize = 1400;
+    config.fragmentTimeout = 1000;
+    config.connectionTimeout = 10000;
+    config.keepAliveInterval = 0;
+    return config;
+}
+
+NetworkMessage makeMessage(uint32_t value, PacketReliability reliability) {
+    NetworkMessage message{};
+    message.data.resize(100);
+    std::memcpy(message.data.data(), &value, sizeof(value));
+    message.reliability = reliability;
+    message.channel = static_cast<uint8_t>(value % CHANNELS);
+    message.clientId = 0;
+    return message;
+}
+
+// Sends MESSAGE_COUNT numbered messages from a client through a proxy that
+// drops LOSS of the datagrams both ways, and records what the server delivers
+struct LossyRun {
+    std::vector<uint32_t> delivered;
+
+    LossyRun(uint16_t port, PacketReliability reliability, bool waitForAll,
+             TransportBackend transport = TransportBackend::SOCKET) {
+        NetworkConfig config = makeConfig(port);
+        config.transport = transport;
+        NetworkManager server, client;
+        CHECK(server.initialize(config));
+        CHECK(server.startServer());
+        Test::LossyProxy proxy(static_cast<uint16_t>(port + 1), port, LOSS);
+        CHECK(client.initialize(config));
+        CHECK(client.connect("127.0.0.1", static_cast<uint16_t>(port + 1)));
+
+        for (uint32_t i = 0; i < MESSAGE_COUNT; ++i) {
+            CHECK(client.send(makeMessage(i, reliability)) > 0);
+            if (i % 50 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            drain(server);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(waitForAll ? 20 : 1);
+        while (std::chrono::steady_clock::now() < deadline &&
+               (!waitForAll || delivered.size() < MESSAGE_COUNT)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            drain(server);
+        }
+        CHECK(proxy.getDropped() > 0);
+        client.shutdown();
+        server.shutdown();
+    }
+
+    void drain(NetworkManager& server) {
+        NetworkMessage message;
+        while (server.receive(message)) {
+            uint32_t value = 0;
+            CHECK(message.data.size() == 100);
+            std::memcpy(&value, message.data.data(), sizeof(value));
+            delivered.push_back(value);
+        }
+    }
+};
+
+bool hasDuplicates(const std::vector<uint32_t>& values) {
+    return std::set<uint32_t>(values.begin(), values.end()).size() != values.size();
+}
+
+// Within each channel the values only ever grow
+bool isOrderedPerChannel(const std::vector<uint32_t>& values) {
+    std::array<int64_t, CHANNELS> last;
+    last.fill(-1);
+    for (uint32_t value : values) {
+        int64_t& previous = last[value % CHANNELS];
+        if (static_cast<int64_t>(value) <= previous) return false;
+        previous = value;
+    }
+    return true;
+}
+
+void testReliableDeliveryUnderLoss() {
+    LossyRun run(40400, PacketReliability::RELIABLE, true);
+    CHECK(run.delivered.size() == MESSAGE_COUNT);
+    CHECK(!hasDuplicates(run.delivered));
+}
+
+void testOrderedDeliveryUnderLoss() {
+    LossyRun run(40402, PacketReliability::RELIABLE_ORDERED, true);
+    CHECK(run.delivered.size() == MESSAGE_COUNT);
+    CHECK(!hasDuplicates(run.delivered));
+    CHECK(isOrderedPerChannel(run.delivered));
+}
+
+void testReliableDeliveryOverIoUring() {
+    LossyRun run(40414, PacketReliability::RELIABLE, true, TransportBackend::IO_URING);
+    CHECK(run.delivered.size() == MESSAGE_COUNT);
+    CHECK(!hasDuplicates(run.delivered));
+}
+
+void testOversizedDatagramsAreSkipped() {
+    NetworkConfig config = makeConfig(40416);
+    config.transport = TransportBackend::IO_URING;
+    config.congestionControl = CongestionAlgorithm::NONE;
+    NetworkManager server, client;
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+
+    // Without fragmentation nothing stops a datagram outgrowing the send slots
+    config.fragmentSize = 0;
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40416));
+
+    // Only the oversized one is lost, not the burst queued behind it
+    NetworkMessage oversized = makeMessage(0, PacketReliability::UNRELIABLE);
+    oversized.data.resize(config.bufferSize + 1);
+    CHECK(client.send(oversized) > 0);
+    constexpr uint32_t BURST = 1000;
+    for (uint32_t i = 1; i <= BURST; ++i) {
+        NetworkMessage message = makeMessage(i, PacketReliability::RELIABLE);
+        message.data.resize(1000);
+        CHECK(client.send(message) > 0);
+    }
+
+    std::set<uint32_t> delivered;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (delivered.size() < BURST && std::chrono::steady_clock::now() < deadline) {
+        NetworkMessage message;
+        while (server.receive(message)) {
+            uint32_t value = 0;
+            std::memcpy(&value, message.data.data(), sizeof(value));
+            delivered.insert(value);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(delivered.size() == BURST);
+    CHECK(delivered.count(0) == 0);
+    CHECK(client.getDroppedDatagrams() == 1);
+    client.shutdown();
+    server.shutdown();
+}
+
+void testFragmentsMustFitBuffers() {
+    NetworkConfig config = makeConfig(40418);
+    config.fragmentSize = config.bufferSize - WireHeader::MAX_SIZE;
+    NetworkManager manager;
+    CHECK(manager.initialize(config));
+
+    // Encryption adds the IV, padding and tag on top
+    config.enableEncryption = true;
+    CHECK(!manager.initialize(config));
+}
+
+void testSequencedNeverGoesBack() {
+    LossyRun run(40404, PacketReliability::UNRELIABLE_SEQUENCED, false);
+    CHECK(!run.delivered.empty());
+    CHECK(run.delivered.size() < MESSAGE_COUNT);
+    CHECK(isOrderedPerChannel(run.delivered));
+}
+
+void testIdleClientTimesOut() {
+    NetworkConfig config = makeConfig(40406);
+    config.connectionTimeout = 500;
+    NetworkManager server, client;
+    std::atomic<int> disconnects{0};
+    server.setDisconnectCallback([&](uint32_t) { disconnects++; });
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40406));
+
+    CHECK(client.send(makeMessage(1, PacketReliability::UNRELIABLE)) > 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(server.getConnectedClients().size() == 1);
+
+    // No keep-alives, so the server gives up after connectionTimeout
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    CHECK(disconnects == 1);
+    CHECK(server.getConnectedClients().empty());
+    client.shutdown();
+    server.shutdown();
+}
+
+void testClientOfMissingServerTimesOut() {
+    NetworkConfig config = makeConfig(40412);
+    config.connectionTimeout = 500;
+    NetworkManager client;
+    std::atomic<int> disconnects{0};
+    client.setDisconnectCallback([&](uint32_t clientId) {
+        CHECK(clientId == 0);
+        disconnects++;
+    });
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40412));
+
+    // Nothing listens on the port, so not a single packet ever comes back
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    CHECK(disconnects == 1);
+    CHECK(client.getConnectedClients().empty());
+    client.shutdown();
+}
+
+void testKeepAlivesHoldIdleConnections() {
+    NetworkConfig config = makeConfig(40408);
+    config.connectionTimeout = 500;
+    config.keepAliveInterval = 100;
+    NetworkManager server, client;
+    std::atomic<int> disconnects{0};
+    server.setDisconnectCallback([&](uint32_t) { disconnects++; });
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40408));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    CHECK(disconnects == 0);
+    CHECK(server.getConnectedClients().size() == 1);
+
+    // Keep-alives are never delivered as messages
+    NetworkMessage message;
+    CHECK(!server.receive(message));
+    CHECK(!client.receive(message));
+    client.shutdown();
+    server.shutdown();
+}
+
+void testVanishedPeerIsDisconnected() {
+    NetworkConfig config = makeConfig(40410);
+    config.connectionTimeout = 0;
+    NetworkManager server, client;
+    std::atomic<int> disconnects{0};
+    server.setDisconnectCallback([&](uint32_t) { disconnects++; });
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", 40410));
+
+    CHECK(client.send(makeMessage(1, PacketReliability::RELIABLE)) > 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto clients = server.getConnectedClients();
+    CHECK(clients.size() == 1);
+    client.shutdown();
+
+    // Nobody acks the resends, so the server gives up once they run out
+    NetworkMessage message = makeMessage(2, PacketReliability::RELIABLE);
+    message.clientId = clients.empty() ? 0 : clients[0];
+    CHECK(server.send(message) > 0);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (disconnects == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(disconnects == 1);
+    CHECK(server.getConnectedClients().empty());
+    server.shutdown();
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testReliableDeliveryUnderLoss);
+    RUN_TEST(testOrderedDeliveryUnderLoss);
+    RUN_TEST(testSequencedNeverGoesBack);
+    RUN_TEST(testReliableDeliveryOverIoUring);
+    RUN_TEST(testOversizedDatagramsAreSkipped);
+    RUN_TEST(testFragmentsMustFitBuffers);
+    RUN_TEST(testIdleClientTimesOut);
+    RUN_TEST(testClientOfMissingServerTimesOut);
+    RUN_TEST(testKeepAlivesHoldIdleConnections);
+    RUN_TEST(testVanishedPeerIsDisconnected);
+    return Test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "NetworkManager.hpp"
+#include "Check.hpp"
+#include <cstring>
+
+using namespace BarrenEngine;
+
+namespace {
+
+constexpr size_t MESSAGE_SIZE = 32 * 1024;
+constexpr size_t MESSAGE_COUNT = 128;          // 4 MB in all
+constexpr float TIME_LIMIT = 5.0f;             // Seconds; a healthy controller needs a fraction of this
+
+// Seconds the client takes to push MESSAGE_COUNT reliable messages to the
+// server over loopback, or a negative value when they did not all arrive
+float measureTransfer(uint16_t port, CongestionAlgorithm algorithm) {
+    NetworkConfig config{};
+    config.port = port;
+    config.maxConnections = 16;
+    config.bufferSize = 1500;
+    config.fragmentSize = 1000;
+    config.maxPacketSize = 1400;
+    config.fragmentTimeout = 5000;
+    config.connectionTimeout = 10000;
+    config.keepAliveInterval = 0;
+    config.congestionControl = algorithm;
+
+    NetworkManager server, client;
+    CHECK(server.initialize(config));
+    CHECK(server.startServer());
+    CHECK(client.initialize(config));
+    CHECK(client.connect("127.0.0.1", port));
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < MESSAGE_COUNT; ++i) {
+        NetworkMessage message{};
+        message.data.resize(MESSAGE_SIZE);
+        std::memcpy(message.data.data(), &i, sizeof(i));
+        message.reliability = PacketReliability::RELIABLE;
+        message.clientId = 0;
+        CHECK(client.send(message) > 0);
+    }
+
+    size_t received = 0;
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<float>(TIME_LIMIT));
+    while (received < MESSAGE_COUNT && std::chrono::steady_clock::now() < deadline) {
+        NetworkMessage message;
+        while (server.receive(message)) {
+            CHECK(message.data.size() == MESSAGE_SIZE);
+            received++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << received << " of " << MESSAGE_COUNT << " messages in " << elapsed << " s" << std::endl;
+
+    client.shutdown();
+    server.shutdown();
+    return received == MESSAGE_COUNT ? elapsed : -1.0f;
+}
+
+void testCubicThroughput() {
+    float elapsed = measureTransfer(40700, CongestionAlgorithm::CUBIC);
+    CHECK(elapsed > 0.0f);
+}
+
+void testBbrThroughput() {
+    float elapsed = measureTransfer(40702, CongestionAlgorithm::BBR);
+    CHECK(elapsed > 0.0f);
+}
+
+void testUncontrolledThroughput() {
+    float elapsed = measureTransfer(40704, CongestionAlgorithm::NONE);
+    CHECK(elapsed > 0.0f);
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testCubicThroughput);
+    RUN_TEST(testBbrThroughput);
+    RUN_TEST(testUncontrolledThroughput);
+    return Test::failures() == 0 ? 0 : 1;
+}
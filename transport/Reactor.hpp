@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+
+namespace BarrenEngine {
+
+// Event loop for the network thread: blocks until the socket is readable,
+// another thread queued outgoing work, or the next protocol deadline expires.
+class Reactor {
+public:
+    enum Event : uint32_t {
+        NONE = 0,
+        SOCKET_READABLE = 1 << 0,
+        WAKEUP = 1 << 1,
+        TIMER = 1 << 2
+    };
+
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool open(int socketHandle);
+    void close();
+    bool isOpen() const;
+
+    // Blocks until at least one event fires; returns a mask of Event bits.
+    // A negative timeout waits indefinitely.
+    uint32_t wait(int timeoutMs = -1);
+
+    // Thread-safe. Coalesces: only the first call between two waits hits the
+    // kernel, so the caller must check for queued work after every wait.
+    void wakeup();
+
+    // Schedule the timer for the given deadline, replacing any earlier one.
+    // time_point::max() disarms it.
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+private:
+    int epollFd_;
+    int eventFd_;
+    int timerFd_;
+    std::atomic<bool> wakeupPending_;
+    std::chrono::steady_clock::time_point armedDeadline_;
+};
+
+} // namespace BarrenEngine
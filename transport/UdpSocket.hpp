@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace BarrenEngine {
+
+// Opaque socket address (large enough for sockaddr_in6)
+struct Endpoint {
+    alignas(8) uint8_t address[28];
+    uint32_t length;
+
+    Endpoint() : address{}, length(0) {}
+
+    bool operator==(const Endpoint& other) const {
+        return length == other.length && std::memcmp(address, other.address, length) == 0;
+    }
+    bool operator!=(const Endpoint& other) const { return !(*this == other); }
+};
+
+struct EndpointHash {
+    size_t operator()(const Endpoint& endpoint) const {
+        // FNV-1a over the raw address bytes
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t i = 0; i < endpoint.length; ++i) {
+            hash ^= endpoint.address[i];
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// A single datagram slot used by the batched send/receive calls.
+// The caller owns the memory pointed to by data.
+struct Datagram {
+    uint8_t* data;
+    uint32_t size;           // Bytes used (filled in on receive)
+    uint32_t capacity;       // Bytes available in data (receive only)
+    uint32_t segmentSize;    // GRO segment size of a coalesced receive, 0 otherwise
+    Endpoint endpoint;       // Destination on send, source on receive
+};
+
+class UdpSocket {
+public:
+    // Upper bound on datagrams handed to the kernel per recvmmsg/sendmmsg call
+    static constexpr size_t MAX_BATCH = 64;
+
+    // Segmentation offload limits
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
+    static constexpr size_t MAX_GSO_BYTES = 65000;
+    static constexpr size_t MAX_GSO_SEGMENT_SIZE = 1452;   // Fits a 1500 byte MTU over IPv6
+    static constexpr size_t MAX_GRO_DATAGRAM = 65535;
+
+    UdpSocket();
+    ~UdpSocket();
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Socket lifetime
+    bool open(uint32_t bufferSize, bool reusePort = false);
+    bool bind(uint16_t port);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    int getHandle() const { return fd_; }
+
+    // UDP GSO/GRO. With GRO on, receive slots must hold MAX_GRO_DATAGRAM bytes.
+    bool enableSegmentationOffload();
+    bool isReceiveOffloadEnabled() const { return groEnabled_; }
+
+    // Batched I/O. Both return the number of datagrams transferred, 0 when the
+    // socket would block, or -1 on error. With offload enabled, sendBatch hands
+    // runs of equal-sized datagrams to the same endpoint to the kernel as one
+    // segmented send.
+    int receiveBatch(Datagram* datagrams, size_t count);
+    int sendBatch(const Datagram* datagrams, size_t count);
+
+    // Address helpers
+    static bool resolve(const std::string& address, uint16_t port, Endpoint& endpoint);
+    static std::string toString(const Endpoint& endpoint);
+
+private:
+    int fd_;
+    bool gsoEnabled_;
+    bool groEnabled_;
+};
+
+} // namespace BarrenEngine
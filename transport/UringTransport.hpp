@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "transport/UdpSocket.hpp"
+
+namespace BarrenEngine {
+
+// io_uring datagram backend layered on an already opened UdpSocket.
+// Receive uses one multishot recvmsg feeding from a provided buffer ring,
+// send copies into registered fixed buffers and submits zero-copy sends,
+// so steady-state I/O needs neither a syscall nor an allocation per packet.
+class UringTransport {
+public:
+    UringTransport();
+    ~UringTransport();
+    UringTransport(const UringTransport&) = delete;
+    UringTransport& operator=(const UringTransport&) = delete;
+
+    // Fails (and leaves nothing behind) when the kernel lacks any required feature
+    bool open(int socketHandle, uint32_t bufferSize);
+    void close();
+    bool isOpen() const { return ringFd_ >= 0; }
+
+    // Pollable descriptor that becomes readable when completions are pending
+    int getHandle() const { return ringFd_; }
+
+    // Same contract as UdpSocket. Received datagrams point straight into the
+    // buffer ring and stay valid until the next receiveBatch call. sendBatch
+    // skips and counts a datagram larger than bufferSize, and stops early
+    // once the send slots or the submission queue run out.
+    int receiveBatch(Datagram* datagrams, size_t count);
+    int sendBatch(const Datagram* datagrams, size_t count);
+
+    // Datagrams sendBatch skipped for not fitting a send slot
+    size_t getDroppedDatagrams() const { return droppedDatagrams_; }
+
+private:
+    static constexpr uint32_t RING_ENTRIES = 256;
+    static constexpr uint32_t RECEIVE_BUFFERS = 512;   // Must be a power of two
+    static constexpr uint32_t SEND_BUFFERS = 256;
+    static constexpr uint16_t BUFFER_GROUP = 0;
+
+    bool setupRing();
+    bool setupBuffers();
+    bool armReceive();
+    void recycleBuffers();
+    void reapCompletions();
+    void cancelPending();
+    void* getSubmissionEntry();
+    int submit();
+    void handleSendCompletion(uint64_t userData, uint32_t flags);
+
+    int socket_;
+    int ringFd_;
+    uint32_t bufferSize_;
+    bool receiveArmed_;
+
+    // Ring mappings
+    void* sqRing_;
+    void* cqRing_;
+    void* sqes_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    size_t sqesSize_;
+    uint32_t sqLocalTail_;
+    uint32_t* sqHead_;
+    uint32_t* sqTail_;
+    uint32_t* sqMask_;
+    uint32_t* sqFlags_;
+    uint32_t* sqArray_;
+    uint32_t* cqHead_;
+    uint32_t* cqTail_;
+    uint32_t* cqMask_;
+    void* cqes_;
+    uint32_t pendingSubmissions_;
+
+    // Provided receive buffers
+    void* bufferRing_;
+    size_t bufferRingSize_;
+    uint16_t bufferRingTail_;
+    uint8_t* receiveArea_;
+    size_t receiveAreaSize_;
+    size_t receiveSlotSize_;
+    std::vector<Datagram> readyDatagrams_;    // Reaped but not yet handed to the caller
+    size_t readyIndex_;
+    std::vector<uint16_t> heldBuffers_;       // Handed to the caller by the last receiveBatch
+    alignas(8) uint8_t receiveHeader_[64];    // msghdr template for the multishot recvmsg
+
+    // Registered send buffers
+    uint8_t* sendArea_;
+    size_t sendAreaSize_;
+    std::vector<uint16_t> freeSendBuffers_;
+    std::vector<Endpoint> sendEndpoints_;     // Destination addresses must outlive submission
+    std::atomic<size_t> droppedDatagrams_;
+};
+
+} // namespace BarrenEngine